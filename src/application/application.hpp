@@ -22,6 +22,7 @@ static auto setup5() -> void;
 static auto setup6() -> void;
 static auto setup7() -> void;
 static auto setup8() -> void;
+static auto setup9() -> void;
 
 // engine interface
 static auto application_print_hello() -> void { printf("\nprogram glosi\n\n"); }
@@ -64,12 +65,12 @@ static auto application_init() -> void {
 
     // the dome
     glob_ix_skydome = glos::globs.load("assets/obj/skydome.obj", nullptr);
-    glos::object* skydome = new (glos::objects.alloc()) glos::object{};
+    glos::object* skydome = glos::objects.alloc<glos::object>();
     skydome->is_static(true);
     skydome->glob_ix(glob_ix_skydome);
     float const skydome_scale = length(glm::vec2{grid_size / 2, grid_size / 2});
-    skydome->bounding_radius = skydome_scale;
-    skydome->scale = {skydome_scale, skydome_scale, skydome_scale};
+    skydome->bounding_radius() = skydome_scale;
+    skydome->scale() = {skydome_scale, skydome_scale, skydome_scale};
 
     glos::background_color = {0, 0, 0};
 
@@ -99,18 +100,18 @@ static auto application_init() -> void {
 
 static auto setup1() -> void {
     // single player mode
-    auto* o0 = new (glos::objects.alloc()) ship{};
-    o0->position.z = 4;
+    auto* o0 = glos::objects.alloc<ship>();
+    o0->position().z = 4;
     o0->net_state = &glos::net.states[1];
 
-    auto* o1 = new (glos::objects.alloc()) cube{};
-    o1->position.x = 5;
-    o1->linear_velocity.x = -1;
+    auto* o1 = glos::objects.alloc<cube>();
+    o1->position().x = 5;
+    o1->linear_velocity().x = -1;
 
-    auto* o2 = new (glos::objects.alloc()) cube{};
-    o2->position.x = -5;
-    o2->position.y = 0.1f;
-    o2->linear_velocity.x = 1;
+    auto* o2 = glos::objects.alloc<cube>();
+    o2->position().x = -5;
+    o2->position().y = 0.1f;
+    o2->linear_velocity().x = 1;
 
     // the vector from the center of the cube to its corner
     glm::vec3 const corner_dir = glm::normalize(glm::vec3{1.0f, 1.0f, 1.0f});
@@ -119,51 +120,51 @@ static auto setup1() -> void {
     glm::vec3 const x_axis = glm::vec3{1.0f, 0.0f, 0.0f};
 
     // calculate the rotation that aligns the corner to the x-axis
-    o2->orientation = glm::rotation(corner_dir, x_axis);
+    o2->orientation() = glm::rotation(corner_dir, x_axis);
 }
 
 static auto setup2() -> void {
-    auto* o1 = new (glos::objects.alloc()) cube{};
+    auto* o1 = glos::objects.alloc<cube>();
 
-    auto* o2 = new (glos::objects.alloc()) cube{};
-    o2->position.z = 3.0f;
-    o2->linear_acceleration.z = -1;
+    auto* o2 = glos::objects.alloc<cube>();
+    o2->position().z = 3.0f;
+    o2->linear_acceleration().z = -1;
 
-    auto* o3 = new (glos::objects.alloc()) cube{};
-    o3->position.z = 6.0f;
-    o3->linear_acceleration.z = -1;
+    auto* o3 = glos::objects.alloc<cube>();
+    o3->position().z = 6.0f;
+    o3->linear_acceleration().z = -1;
 }
 
 static auto setup3() -> void {
     // single player mode
-    auto* o0 = new (glos::objects.alloc()) ship{};
-    o0->position.z = 4;
+    auto* o0 = glos::objects.alloc<ship>();
+    o0->position().z = 4;
     o0->net_state = &glos::net.states[1];
 
-    auto* o1 = new (glos::objects.alloc()) cube{};
-    o1->position.x = 5;
-    o1->linear_velocity.x = -1;
+    auto* o1 = glos::objects.alloc<cube>();
+    o1->position().x = 5;
+    o1->linear_velocity().x = -1;
 
-    auto* o2 = new (glos::objects.alloc()) cube{};
-    o2->position.x = -5;
-    o2->linear_velocity.x = 1;
+    auto* o2 = glos::objects.alloc<cube>();
+    o2->position().x = -5;
+    o2->linear_velocity().x = 1;
 }
 
 static auto setup4() -> void {
     // single player mode
-    auto* o0 = new (glos::objects.alloc()) ship{};
-    o0->position.z = 4;
+    auto* o0 = glos::objects.alloc<ship>();
+    o0->position().z = 4;
     o0->net_state = &glos::net.states[1];
 
-    auto* o1 = new (glos::objects.alloc()) cube{};
+    auto* o1 = glos::objects.alloc<cube>();
     o1->name = "right";
-    o1->position.x = 5;
-    o1->linear_velocity.x = -1;
+    o1->position().x = 5;
+    o1->linear_velocity().x = -1;
 
-    auto* o2 = new (glos::objects.alloc()) cube{};
+    auto* o2 = glos::objects.alloc<cube>();
     o2->name = "left";
-    o2->position.x = -5;
-    o2->linear_velocity.x = 1;
+    o2->position().x = -5;
+    o2->linear_velocity().x = 1;
 
     // the vector from the center of the cube to its corner
     glm::vec3 const corner_dir = glm::normalize(glm::vec3{1.0f, 1.0f, 1.0f});
@@ -172,13 +173,13 @@ static auto setup4() -> void {
     glm::vec3 const x_axis = glm::vec3{1.0f, 0.0f, 0.0f};
 
     // calculate the rotation that aligns the corner to the x-axis
-    o2->orientation = glm::rotation(corner_dir, x_axis);
+    o2->orientation() = glm::rotation(corner_dir, x_axis);
 }
 
 static auto setup5() -> void {
-    auto* o1 = new (glos::objects.alloc()) cube{};
-    o1->position.x = 5;
-    o1->linear_velocity.x = -1;
+    auto* o1 = glos::objects.alloc<cube>();
+    o1->position().x = 5;
+    o1->linear_velocity().x = -1;
 
     // the vector from the center of the cube to its corner
     glm::vec3 const corner_dir = glm::normalize(glm::vec3{1.0f, 1.0f, 1.0f});
@@ -187,27 +188,27 @@ static auto setup5() -> void {
     glm::vec3 const x_axis = glm::vec3{1.0f, 0.0f, 0.0f};
 
     // calculate the rotation that aligns the corner to the x-axis
-    o1->orientation = glm::rotation(corner_dir, x_axis);
+    o1->orientation() = glm::rotation(corner_dir, x_axis);
 
-    auto* o2 = new (glos::objects.alloc()) cube{};
+    auto* o2 = glos::objects.alloc<cube>();
     o2->is_static(true);
 }
 
 static auto setup6() -> void {
-    auto* o1 = new (glos::objects.alloc()) cube{};
+    auto* o1 = glos::objects.alloc<cube>();
     o1->name = "right";
-    o1->position.x = 5;
-    o1->linear_velocity.x = -1;
+    o1->position().x = 5;
+    o1->linear_velocity().x = -1;
 
-    auto* o2 = new (glos::objects.alloc()) cube{};
+    auto* o2 = glos::objects.alloc<cube>();
     o2->name = "static";
     o2->is_static(true);
 }
 
 static auto setup7() -> void {
-    auto* o1 = new (glos::objects.alloc()) cube{};
-    o1->position.x = 5;
-    o1->linear_velocity.x = -1;
+    auto* o1 = glos::objects.alloc<cube>();
+    o1->position().x = 5;
+    o1->linear_velocity().x = -1;
 
     // the vector from the center of the cube to its corner
     glm::vec3 const corner_dir = glm::normalize(glm::vec3{1.0f, 1.0f, 1.0f});
@@ -216,26 +217,44 @@ static auto setup7() -> void {
     glm::vec3 const x_axis = glm::vec3{1.0f, 0.0f, 0.0f};
 
     // calculate the rotation that aligns the corner to the x-axis
-    o1->orientation = glm::rotation(corner_dir, x_axis);
+    o1->orientation() = glm::rotation(corner_dir, x_axis);
 
-    auto* o2 = new (glos::objects.alloc()) cube{};
+    auto* o2 = glos::objects.alloc<cube>();
 }
 
 static auto setup8() -> void {
-    auto* o1 = new (glos::objects.alloc()) cube{};
+    auto* o1 = glos::objects.alloc<cube>();
     o1->is_static(true);
 
-    auto* o2 = new (glos::objects.alloc()) cube{};
-    o2->position = {0, 0, -2.05f};
-    o2->linear_velocity = {0, 0, 0.1f};
+    auto* o2 = glos::objects.alloc<cube>();
+    o2->position() = {0, 0, -2.05f};
+    o2->linear_velocity() = {0, 0, 0.1f};
 
-    auto* o3 = new (glos::objects.alloc()) cube{};
-    o3->position = {0, 0, -4.10f};
-    o3->linear_velocity = {0, 0, 0.1f};
+    auto* o3 = glos::objects.alloc<cube>();
+    o3->position() = {0, 0, -4.10f};
+    o3->linear_velocity() = {0, 0, 0.1f};
 
-    auto* o4 = new (glos::objects.alloc()) cube{};
-    o4->position = {0, 0, -6.15f};
-    o4->linear_velocity = {0, 0, 0.1f};
+    auto* o4 = glos::objects.alloc<cube>();
+    o4->position() = {0, 0, -6.15f};
+    o4->linear_velocity() = {0, 0, 0.1f};
+}
+
+static auto setup9() -> void {
+    // fast swept cube against a thin static cube
+    // note: the cube moves several times the thickness of the thin cube per
+    //       frame and passes through it without continuous collision
+    //       detection. the hit is printed by 'cube::on_collision'
+    auto* o1 = glos::objects.alloc<cube>();
+    o1->name = "fast";
+    o1->position().x = 23;
+    o1->linear_velocity().x = -300;
+    o1->is_swept = true;
+
+    auto* o2 = glos::objects.alloc<cube>();
+    o2->name = "thin";
+    o2->scale() = {0.1f, 2, 2};
+    o2->bounding_radius() = o2->glob().bounding_radius * 2;
+    o2->is_static(true);
 }
 
 // engine interface
@@ -20,10 +20,129 @@
 static bool constexpr threaded_grid = false;
 static bool constexpr threaded_update = false;
 
+// placement of threads on cpus as lists of cpus and ranges e.g. "0-3,8"
+// note: empty string to let the thread run on any cpu
+// note: workers are the threads of parallel passes and of update jobs
+static char constexpr const* render_thread_cpus = "";
+static char constexpr const* update_thread_cpus = "";
+static char constexpr const* workers_cpus = "";
+
+// number of threads of parallel passes including the calling thread
+// note: 0 for the number of cores
+static uint32_t constexpr workers_count = 0;
+
+// microseconds threads of update jobs spin for work before sleeping
+static uint32_t constexpr workers_spin_us = 50;
+
+// spinlocks used by objects, planes and o1store back off exponentially up to
+// this many pause instructions per spin
+static uint32_t constexpr spinlock_max_backoff = 64;
+// spinlocks wait on the lock (futex) after this many spins
+// note: 0 to only spin
+static uint32_t constexpr spinlock_spins_before_wait = 256;
+// count acquisitions and spins of each lock site and show them in metrics
+// note: counting adds contention on the counters
+static bool constexpr spinlock_counters_enabled = false;
+
+// update of next frame runs on a separate thread while current frame is
+// rendered. update hands the state to render, object matrices and camera,
+// through a triple buffer without locks
+// note: independent of 'threaded_update' which is ignored when this is set
+// note: debug rendering of objects is not done in this mode
+// note: every allocated object is rendered with its glob thus overrides of
+//       'object::render()' are not called and objects outside the grid are
+//       not culled
+static bool constexpr threaded_update_pipelined = false;
+
+// stages of update run as a graph of jobs where stages without dependency
+// between them run in parallel on this many threads in addition to the update
+// thread
+// note: the stages integrate, update, update matrices, resolve collisions and
+//       apply instances depend on each other in that order
+// note: 0 to run the stages on the update thread
+static uint32_t constexpr update_jobs_threads = 0;
+
+// print average time of each stage of update at exit
+static bool constexpr update_jobs_print_times = false;
+
+// sleeping of resting objects
+// note: an object without linear acceleration and with linear and angular
+//       velocity below the thresholds for 'sleep_frames' frames is put to
+//       sleep and is not updated until woken by contact with a moving object,
+//       by setting its velocity or acceleration or by 'object::wake()'
+static bool constexpr sleep_enabled = true;
+static float constexpr sleep_linear_velocity = 0.05f;  // meters/second
+static float constexpr sleep_angular_velocity = 0.05f; // radians/second
+static uint32_t constexpr sleep_frames = 60;
+
+// motion of objects is integrated in a batched pass over the live slots that
+// is parallel when 'threaded_grid' and at least this many objects are
+// allocated
+static uint32_t constexpr integrate_motion_parallel_min_objects = 4096;
+
+// skip narrow phase collision detection of objects with bounding spheres in
+// collision that are moving away from each other
+// note: culled pairs are not notified with 'on_collision' thus objects that
+//       react to overlap rather than approach miss callbacks when enabled
+static bool constexpr cull_separating_pairs = false;
+
+// continuous collision detection of swept convex volumes steps along the path
+// at most this many times per pair and frame
+static uint32_t constexpr swept_max_steps = 64;
+
+// contact solver of collisions between convex volumes bounded by planes
+// note: contacts persist between frames and the solver starts from the
+//       impulses of previous frame thus few iterations are needed
+static uint32_t constexpr contact_solver_iterations = 4;
+static float constexpr contact_restitution = 1; // 0: inelastic, 1: elastic
+static float constexpr contact_restitution_threshold = 1; // meters/second
+// note: contacts approaching slower than threshold do not bounce which lets
+//       stacked objects come to rest
+static float constexpr contact_baumgarte = 0.2f; // fraction corrected per frame
+static float constexpr contact_slop = 0.01f;     // allowed penetration meters
+
+// fixed time step simulation
+// note: when enabled the simulation runs from 0 to
+//       'simulation_max_ticks_per_frame' ticks per rendered frame at
+//       'simulation_tick_rate' and render interpolates objects between the
+//       last two simulated states
+// note: multiplayer mode uses 'dt' from server and runs one tick per frame
+static bool constexpr fixed_time_step = false;
+static float constexpr simulation_tick_rate = 60; // ticks per second
+static uint32_t constexpr simulation_max_ticks_per_frame = 4;
+// note: limits the number of ticks per frame when simulation cannot keep up
+//       and the remaining simulation time is dropped
+
 // o1store debugging (assertions should be on in development)
 static bool constexpr o1store_check_double_free = false;
 static bool constexpr o1store_check_free_limits = false;
 
+// thread safe o1store: number of threads with a cache and number of instances
+// taken from or returned to the shared lists at a time by a thread
+// note: threads beyond 'o1store_thread_caches' use the shared lists directly
+// note: a refill takes at most the instances of a chunk divided by
+//       'o1store_thread_cache_chunk_divisor' thus a few threads cannot hold
+//       all free instances of a size class with few instances per chunk
+// note: cached instances are returned at 'apply_free' and when the store is
+//       out of instances a thread takes free instances cached by other
+//       threads
+static uint32_t constexpr o1store_thread_caches = 64;
+static uint32_t constexpr o1store_thread_cache_size = 16;
+static uint32_t constexpr o1store_thread_cache_chunk_divisor = 8;
+
+// o1store chunks of instances with custom size are mapped with 'mmap' instead
+// of allocated and cleared thus pages are zero filled by the system when
+// first touched
+// * huge pages: advises the system to back chunks with transparent huge
+//   pages to reduce TLB misses when iterating objects
+// * first touch: pages of a new chunk are touched in parallel by the worker
+//   threads so that on NUMA systems the pages are spread over the nodes of
+//   the threads instead of the node of the thread that allocates the chunk
+static bool constexpr o1store_mmap = true;
+static bool constexpr o1store_huge_pages = true;
+static bool constexpr o1store_first_touch = false;
+static size_t constexpr o1store_huge_page_size_B = 2 * 1024 * 1024;
+
 // metrics print to console
 static bool constexpr metrics_print = true;
 
@@ -63,6 +182,12 @@ static uint32_t constexpr grid_rows = 1;
 static uint32_t constexpr grid_columns = grid_rows;
 static float constexpr grid_cell_size = grid_size / grid_rows;
 
+// objects are added to grid in parallel when 'threaded_grid' and at least
+// this many objects are allocated. each worker adds chunks of this many
+// objects
+static uint32_t constexpr grid_add_parallel_min_objects = 4096;
+static uint32_t constexpr grid_add_parallel_chunk_size = 1024;
+
 // window dimensions
 static uint32_t constexpr window_width = 1024;
 static uint32_t constexpr window_height = 1024;
@@ -72,16 +197,64 @@ static bool constexpr window_vsync = is_performance_test ? false : true;
 // number of players in networked mode
 static uint32_t constexpr net_players = 2;
 
+// maximum size of a message payload between server and clients
+// note: a larger size in a message header is treated as a corrupt stream
+static uint32_t constexpr net_message_max_size_B = 64 * 1024;
+
+// transport of net: tcp or udp with redundant history
+// * a udp packet carries the last 'net_udp_history' frames not acknowledged
+//   by the peer thus a lost packet is recovered by the next one
+// * client resends its inputs when no frame has arrived within
+//   'net_udp_resend_ms' which bounds the stall of a lost packet instead of a
+//   tcp retransmit timeout
+static bool constexpr net_udp = false;
+static uint32_t constexpr net_udp_history = 8;
+static int constexpr net_udp_resend_ms = 5;
+
+// simulated loss and latency of received udp packets for testing on loopback
+static uint32_t constexpr net_udp_shim_loss_percent = 0;
+static uint32_t constexpr net_udp_shim_latency_ms = 0;
+
 // multiplayer debugging output
 static bool constexpr debug_multiplayer = false;
 
+// size classes of objects store: instance size in bytes and number of
+// preallocated instances
+// note: 'objects.alloc<type>()' places the object in the smallest size class
+//       that fits 'type'
+// note: sizes must be ascending and multiple of 'cache_line_size_B'
+static size_t constexpr objects_small_instance_size_B = 512;
+static uint32_t constexpr objects_small_count =
+    is_performance_test ? 16 * 1024 : 256;
+static size_t constexpr objects_medium_instance_size_B = 1024;
+static uint32_t constexpr objects_medium_count = 64;
+static size_t constexpr objects_large_instance_size_B = 4096;
+static uint32_t constexpr objects_large_count = 16;
+
+// size classes grow on demand by chunks of the preallocated number of
+// instances up to the maximum number of chunks
+// note: 1 to preallocate all instances and throw when out of instances
+static uint32_t constexpr objects_max_chunks = 4;
+
+// print the maximum number of objects allocated in each size class at exit
+// note: used to set the preallocated number of instances
+static bool constexpr objects_print_high_water_marks = false;
+
 // maximum size of any object instance in bytes
-// note: must be multiple of 'cache_line_size_B'
-static size_t constexpr objects_instance_size_B = 1024;
+static size_t constexpr objects_instance_size_B = objects_large_instance_size_B;
 
-// number of preallocated objects
+// maximum number of objects
 static uint32_t constexpr objects_count =
-    is_performance_test ? 64 * 1024 : 1 * 1024;
+    (objects_small_count + objects_medium_count + objects_large_count) *
+    objects_max_chunks;
+
+// maximum number of object types allocated with 'objects.alloc<type>()'
+static uint32_t constexpr objects_max_types = 64;
+
+// frames between reordering objects and their state in memory by position in
+// grid so that objects that are close in the world are close in memory
+// note: 0 to disable
+static uint32_t constexpr objects_compact_interval_frames = 256;
 
 // collision bits
 static uint32_t constexpr cb_none = 0;
@@ -11,12 +11,12 @@ class cube final : public glos::object {
   public:
     cube() {
         glob_ix(glob_ix_cube);
-        scale = {1.f, 1.f, 1.f};
-        bounding_radius = glob().bounding_radius * scale.x;
+        scale() = {1.f, 1.f, 1.f};
+        bounding_radius() = glob().bounding_radius * scale().x;
         mass(1);
-        invIm = calculate_invIm(mass(), scale);
-        collision_bits = cb_cube;
-        collision_mask = cb_cube | cb_ship | cb_tetra;
+        invIm = calculate_invIm(mass(), scale());
+        collision_bits() = cb_cube;
+        collision_mask() = cb_cube | cb_ship | cb_tetra;
     }
 
     bool on_collision(object* obj) override {
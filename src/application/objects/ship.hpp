@@ -12,11 +12,13 @@ class ship final : public glos::object {
   public:
     ship() {
         glob_ix(glob_ix_cube);
-        scale = {1.0f, 1.0f, 1.0f};
-        bounding_radius = glob().bounding_radius * scale.x;
+        scale() = {1.0f, 1.0f, 1.0f};
+        bounding_radius() = glob().bounding_radius * scale().x;
         mass(1);
-        collision_bits = cb_ship;
-        collision_mask = cb_cube | cb_static_object;
+        collision_bits() = cb_ship;
+        collision_mask() = cb_cube | cb_static_object;
+        can_sleep = false;
+        // note: controls are handled in 'update()'
     }
 
     auto update() -> bool override {
@@ -26,8 +28,8 @@ class ship final : public glos::object {
 
         float const dt = glos::frame_context.dt;
 
-        angular_velocity = {};
-        linear_acceleration = {};
+        angular_velocity() = {};
+        linear_acceleration() = {};
 
         if (net_state == nullptr) {
             return true;
@@ -35,21 +37,21 @@ class ship final : public glos::object {
 
         uint64_t const keys = net_state->keys;
 
-        glm::vec3 const forward{orientation * glm::vec3{0.0f, 0.0f, -1.0f}};
-        angular_velocity.y = 0.0f;
+        glm::vec3 const forward{orientation() * glm::vec3{0.0f, 0.0f, -1.0f}};
+        angular_velocity().y = 0.0f;
 
         // handle ship controls
         if (keys & glos::key_w) {
-            linear_acceleration = 10.0f * forward;
+            linear_acceleration() = 10.0f * forward;
         }
         if (keys & glos::key_s) {
-            linear_velocity = {};
+            linear_velocity() = {};
         }
         if (keys & glos::key_a) {
-            angular_velocity.y = deg_to_rad(120.f);
+            angular_velocity().y = deg_to_rad(120.f);
         }
         if (keys & glos::key_d) {
-            angular_velocity.y = -deg_to_rad(120.f);
+            angular_velocity().y = -deg_to_rad(120.f);
         }
         if (keys & glos::key_k) {
             glos::camera.type = glos::camera::type::LOOK_AT;
@@ -11,11 +11,11 @@ class sphere final : public glos::object {
   public:
     sphere() {
         glob_ix(glob_ix_sphere);
-        scale = {1.0f, 1.0f, 1.0f};
-        bounding_radius = glob().bounding_radius * scale.x;
+        scale() = {1.0f, 1.0f, 1.0f};
+        bounding_radius() = glob().bounding_radius * scale().x;
         is_sphere = true;
         mass(1);
-        collision_bits = cb_sphere;
-        collision_mask = cb_none;
+        collision_bits() = cb_sphere;
+        collision_mask() = cb_none;
     }
 };
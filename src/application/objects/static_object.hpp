@@ -10,7 +10,7 @@
 class static_object final : public glos::object {
   public:
     static_object() {
-        collision_bits = cb_static_object;
-        collision_mask = cb_none;
+        collision_bits() = cb_static_object;
+        collision_mask() = cb_none;
     }
 };
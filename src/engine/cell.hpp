@@ -10,10 +10,12 @@
 #include "decouple.hpp"
 #include "objects.hpp"
 #include "planes.hpp"
+#include "solver.hpp"
+#include <cmath>
 #include <cstdint>
+#include <functional>
 #include <glm/glm.hpp>
-#include <glm/gtx/string_cast.hpp>
-#include <print>
+#include <optional>
 #include <utility>
 
 namespace glos {
@@ -39,68 +41,45 @@ class cell final {
         bool notify2 = false;
     };
 
+    // pair with a swept object found by 'find_collisions' and handled by
+    // 'handle_collisions' after the swept objects have been moved to the
+    // earliest time of impact
+    struct swept_collision final {
+        sphere_collision cc{};
+        glm::vec3 o1_start{}; // position at beginning of frame
+        glm::vec3 o1_end{};   // position at end of frame
+        glm::vec3 o2_start{};
+        glm::vec3 o2_end{};
+        float time = 1;     // fraction of frame at impact of this pair
+        glm::vec3 point{};  // sphere vs volume: point relative to volume
+        glm::vec3 normal{}; // sphere vs volume: normal of plane hit
+    };
+
     struct point_normal_collision final {
         object* o1 = nullptr;
         object* o2 = nullptr;
-        glm::vec3 point{};  // point of collision in o2
-        glm::vec3 normal{}; // normal of collision surface in o1
+        glm::vec3 point{};    // point of collision in o2
+        glm::vec3 normal{};   // normal of collision surface in o1
+        float depth = 0;      // penetration of point along normal
+        uint32_t feature = 0; // identifies the contact between frames
         bool notify1 = false;
         bool notify2 = false;
     };
 
     std::vector<entry> moving_entries_vector{};
+    std::vector<entry> sleeping_entries_vector{};
     std::vector<entry> static_entries_vector{};
     std::vector<sphere_collision> check_collisions_vector{};
     std::vector<sphere_collision> sphere_collisions_vector{};
+    std::vector<swept_collision> swept_collisions_vector{};
     std::vector<point_normal_collision> point_normal_collisions{};
+    uint32_t culled_pairs = 0; // pairs moving away from each other last pass
 
-    auto update_objects_in_vector(std::vector<entry> const& vec) const -> void {
-        uint32_t const frame_num = uint32_t(frame_context.frame_num);
-        // note: ok to truncate because only equality is checked
-        for (entry const& ce : vec) {
-            if (threaded_grid) {
-                // multithreaded mode
-                if (ce.object->overlaps_cells) [[unlikely]] {
-                    // object is in several cells and may be called from
-                    // multiple threads
-                    ce.object->acquire_lock();
-                    if (ce.object->updated_at_tick == frame_num) {
-                        // object already updated in a different cell by a
-                        // different thread
-                        ce.object->release_lock();
-                        continue;
-                    }
-                    ce.object->updated_at_tick = frame_num;
-                    ce.object->release_lock();
-                }
-            } else {
-                // single threaded mode
-                if (ce.object->overlaps_cells) [[unlikely]] {
-                    // object is in several cells and may be called from
-                    // multiple cells
-                    if (ce.object->updated_at_tick == frame_num) {
-                        // already called from a different cell
-                        continue;
-                    }
-                    ce.object->updated_at_tick = frame_num;
-                }
-            }
-
-            // only one thread at a time is here for 'ce.object'
-
-            if (!ce.object->update()) {
-                ce.object->is_dead = true;
-                objects.free(ce.object);
-                continue;
-            }
-
-            // note: opportunity to clear the list prior to 'resolve_collisions'
-            ce.object->clear_handled_collisions();
-        }
-    }
+    // feature of contacts found by continuous collision detection
+    static uint32_t constexpr swept_contact_feature = 0xffff'ffff;
 
     auto render_objects_in_vector(std::vector<entry> const& vec) const -> void {
-        uint32_t const frame_num = uint32_t(frame_context.frame_num);
+        uint32_t const frame_num = uint32_t(render_context.frame_num);
         // note: ok to truncate because only equality is checked
         for (entry const& ce : vec) {
             if (ce.object->overlaps_cells) [[unlikely]] {
@@ -116,39 +95,102 @@ class cell final {
     }
 
   public:
-    // called from grid
-    auto update() const -> void {
-        update_objects_in_vector(moving_entries_vector);
-        update_objects_in_vector(static_entries_vector);
-    }
-
-    auto resolve_collisions() -> void {
+    // called from grid, cells may run in parallel
+    // note: swept objects are not moved, instead the earliest time of impact
+    //       of each swept object is recorded in 'slices'
+    auto find_collisions() -> void {
         make_check_collisions_vector();
         process_check_collisions_vector();
+    }
+
+    // called from grid from one thread after 'find_collisions' of all cells
+    // moves swept objects to the earliest time of impact found by any cell
+    // note: a swept object in several cells is moved to the same position by
+    //       each of them
+    auto move_swept_objects_to_time_of_impact() const -> void {
+        for (swept_collision const& sc : swept_collisions_vector) {
+            move_to_time_of_impact(sc.cc.o1, sc.o1_start, sc.o1_end);
+            move_to_time_of_impact(sc.cc.o2, sc.o2_start, sc.o2_end);
+        }
+    }
+
+    // called from grid after 'move_swept_objects_to_time_of_impact', cells
+    // may run in parallel
+    auto handle_collisions() -> void {
+        process_swept_collisions_vector();
         handle_check_collisions_vector();
     }
 
+    // called from grid from one thread after 'handle_collisions' of all cells
+    auto clear_swept_time_of_impact() const -> void {
+        for (swept_collision const& sc : swept_collisions_vector) {
+            slices.time_of_impact[sc.cc.o1->slot()] = 1;
+            slices.time_of_impact[sc.cc.o2->slot()] = 1;
+        }
+    }
+
+    // called from grid (from only one thread)
+    auto add_contacts_to_solver() const -> void {
+        for (point_normal_collision const& pnc : point_normal_collisions) {
+            solver.add(pnc.o1, pnc.o2, pnc.point, pnc.normal, pnc.depth,
+                       pnc.feature);
+        }
+    }
+
     // called from grid (from only one thread)
     auto render() const -> void {
         render_objects_in_vector(moving_entries_vector);
+        render_objects_in_vector(sleeping_entries_vector);
         render_objects_in_vector(static_entries_vector);
     }
 
     // called from grid (from only one thread)
-    auto clear_non_static_entries() -> void { moving_entries_vector.clear(); }
+    auto clear_non_static_entries() -> void {
+        moving_entries_vector.clear();
+        sleeping_entries_vector.clear();
+    }
+
+    // called from grid (from only one thread)
+    auto add(object* o) -> void { add(o, o->position(), o->bounding_radius()); }
+
+    // called from grid (from only one thread)
+    // note: swept objects are added with the bounding sphere of the path
+    auto add(object* o, glm::vec3 const& position, float const radius)
+        -> void {
+        std::vector<entry>& vec =
+            o->is_sleeping_ ? sleeping_entries_vector : moving_entries_vector;
+        vec.emplace_back(position, radius, o->collision_bits(),
+                         o->collision_mask(), o);
+    }
 
     // called from grid (from only one thread)
-    auto add(object* o) -> void {
-        moving_entries_vector.emplace_back(o->position, o->bounding_radius,
-                                           o->collision_bits, o->collision_mask,
-                                           o);
+    // appends entries to be set by 'set_entry'
+    // @return index of first appended moving and sleeping entry
+    auto append_entries(uint32_t const moving_count,
+                        uint32_t const sleeping_count)
+        -> std::pair<uint32_t, uint32_t> {
+        uint32_t const moving_ix = uint32_t(moving_entries_vector.size());
+        uint32_t const sleeping_ix = uint32_t(sleeping_entries_vector.size());
+        moving_entries_vector.resize(moving_ix + moving_count);
+        sleeping_entries_vector.resize(sleeping_ix + sleeping_count);
+        return {moving_ix, sleeping_ix};
+    }
+
+    // called from grid
+    // note: entries at different indexes may be set in parallel
+    auto set_entry(uint32_t const ix, object* o, glm::vec3 const& position,
+                   float const radius) -> void {
+        std::vector<entry>& vec =
+            o->is_sleeping_ ? sleeping_entries_vector : moving_entries_vector;
+        vec[ix] = {position, radius, o->collision_bits(), o->collision_mask(),
+                   o};
     }
 
     // called from grid (from only one thread)
     auto add_static(object* o) -> void {
-        static_entries_vector.emplace_back(o->position, o->bounding_radius,
-                                           o->collision_bits, o->collision_mask,
-                                           o);
+        static_entries_vector.emplace_back(
+            o->position(), o->bounding_radius(), o->collision_bits(),
+            o->collision_mask(), o);
     }
 
     auto remove_static(object const* o) -> void {
@@ -168,6 +210,14 @@ class cell final {
             printf("%s", ce.object->name.c_str());
         }
         printf("\n");
+        printf("sleeping: ");
+        for (entry const& ce : sleeping_entries_vector) {
+            if (i++) {
+                printf(", ");
+            }
+            printf("%s", ce.object->name.c_str());
+        }
+        printf("\n");
         printf("static: ");
         for (entry const& ce : static_entries_vector) {
             if (i++) {
@@ -179,17 +229,21 @@ class cell final {
     }
 
     auto objects_count() const -> uint32_t {
-        return uint32_t(moving_entries_vector.size());
+        return uint32_t(moving_entries_vector.size() +
+                        sleeping_entries_vector.size());
     }
 
     auto static_objects_count() const -> uint32_t {
         return uint32_t(static_entries_vector.size());
     }
 
+    auto culled_pairs_count() const -> uint32_t { return culled_pairs; }
+
   private:
     // called from one thread
     auto make_check_collisions_vector() -> void {
         check_collisions_vector.clear();
+        culled_pairs = 0;
 
         // check static objects vs moving objects
         uint32_t const len_moving = uint32_t(moving_entries_vector.size());
@@ -198,13 +252,19 @@ class cell final {
             entry const& e1 = static_entries_vector[i];
             for (uint32_t j = 0; j < len_moving; ++j) {
                 entry const& e2 = moving_entries_vector[j];
-                bool const notify1 = e1.collision_mask & e2.collision_bits;
-                bool const notify2 = e2.collision_mask & e1.collision_bits;
-                if ((notify1 || notify2) &&
-                    bounding_spheres_are_in_collision(e1, e2)) {
-                    check_collisions_vector.emplace_back(e1.object, e2.object,
-                                                         notify1, notify2);
-                }
+                add_to_check_collisions_vector_if_in_collision(e1, e2);
+            }
+        }
+
+        // check sleeping objects vs moving objects
+        // note: sleeping objects are not checked against static or other
+        //       sleeping objects
+        uint32_t const len_sleeping = uint32_t(sleeping_entries_vector.size());
+        for (uint32_t i = 0; i < len_sleeping; ++i) {
+            entry const& e1 = sleeping_entries_vector[i];
+            for (uint32_t j = 0; j < len_moving; ++j) {
+                entry const& e2 = moving_entries_vector[j];
+                add_to_check_collisions_vector_if_in_collision(e1, e2);
             }
         }
 
@@ -217,20 +277,38 @@ class cell final {
             entry const& e1 = moving_entries_vector[i];
             for (uint32_t j = i + 1; j < len_moving; ++j) {
                 entry const& e2 = moving_entries_vector[j];
-                bool const notify1 = e1.collision_mask & e2.collision_bits;
-                bool const notify2 = e2.collision_mask & e1.collision_bits;
-                if ((notify1 || notify2) &&
-                    bounding_spheres_are_in_collision(e1, e2)) {
-                    check_collisions_vector.emplace_back(e1.object, e2.object,
-                                                         notify1, notify2);
-                }
+                add_to_check_collisions_vector_if_in_collision(e1, e2);
             }
         }
     }
 
+    auto add_to_check_collisions_vector_if_in_collision(entry const& e1,
+                                                        entry const& e2)
+        -> void {
+        bool const notify1 = e1.collision_mask & e2.collision_bits;
+        bool const notify2 = e2.collision_mask & e1.collision_bits;
+        if (!notify1 && !notify2) {
+            return;
+        }
+
+        if (!bounding_spheres_are_in_collision(e1, e2)) {
+            return;
+        }
+
+        if (cull_separating_pairs && are_separating(e1, e2)) {
+            // objects move away from each other; skip narrow phase
+            ++culled_pairs;
+            return;
+        }
+
+        check_collisions_vector.emplace_back(e1.object, e2.object, notify1,
+                                             notify2);
+    }
+
     // called from one thread
     auto process_check_collisions_vector() -> void {
         sphere_collisions_vector.clear();
+        swept_collisions_vector.clear();
         point_normal_collisions.clear();
 
         for (sphere_collision& cc : check_collisions_vector) {
@@ -238,6 +316,11 @@ class cell final {
             object* o1 = cc.o1;
             object* o2 = cc.o2;
 
+            if (o1->is_swept || o2->is_swept) [[unlikely]] {
+                process_swept_collision(cc);
+                continue;
+            }
+
             bool const o1_is_sphere = o1->is_sphere;
             bool const o2_is_sphere = o2->is_sphere;
 
@@ -252,7 +335,7 @@ class cell final {
                 // o2 is not a sphere
                 o2->update_planes_world_coordinates();
                 if (o2->planes.are_in_collision_with_sphere(
-                        o1->position, o1->bounding_radius)) {
+                        o1->position(), o1->bounding_radius())) {
                     std::unreachable(); // todo
                 }
                 continue;
@@ -262,52 +345,285 @@ class cell final {
                 // o1 is not a sphere
                 o1->update_planes_world_coordinates();
                 if (o1->planes.are_in_collision_with_sphere(
-                        o2->position, o2->bounding_radius)) {
+                        o2->position(), o2->bounding_radius())) {
                     std::unreachable(); // todo
                 }
                 continue;
             }
 
             // both objects are convex volumes bounded by planes
+            process_planes_collision(cc);
+        }
+    }
 
-            o1->update_planes_world_coordinates();
-            o2->update_planes_world_coordinates();
-
-            {
-                std::vector<planes::collision> const cols =
-                    o1->planes.points_planes_collisions(
-                        o2->planes, o1->linear_velocity - o2->linear_velocity);
-
-                for (planes::collision const& col : cols) {
-                    // swap so that o1 is the plane normal and o2 is the point
-                    // according to reference
-                    // https://en.wikipedia.org/wiki/Collision_response
-                    point_normal_collisions.emplace_back(
-                        cc.o2, cc.o1, col.point, col.normal, cc.notify2,
-                        cc.notify1);
-                }
+    auto process_planes_collision(sphere_collision const& cc) -> void {
+        object* o1 = cc.o1;
+        object* o2 = cc.o2;
+
+        o1->update_planes_world_coordinates();
+        o2->update_planes_world_coordinates();
+
+        {
+            std::vector<planes::collision> const cols =
+                o1->planes.points_planes_collisions(
+                    o2->planes, o1->linear_velocity() - o2->linear_velocity());
+
+            for (planes::collision const& col : cols) {
+                // swap so that o1 is the plane normal and o2 is the point
+                // according to reference
+                // https://en.wikipedia.org/wiki/Collision_response
+                point_normal_collisions.emplace_back(
+                    cc.o2, cc.o1, col.point, col.normal, col.depth,
+                    col.feature, cc.notify2, cc.notify1);
+            }
 
-                if (!cols.empty()) {
-                    continue;
-                }
+            if (!cols.empty()) {
+                return;
             }
+        }
 
-            {
-                std::vector<planes::collision> const cols =
-                    o2->planes.points_planes_collisions(
-                        o1->planes, o2->linear_velocity - o1->linear_velocity);
+        {
+            std::vector<planes::collision> const cols =
+                o2->planes.points_planes_collisions(
+                    o1->planes, o2->linear_velocity() - o1->linear_velocity());
 
-                for (planes::collision const& col : cols) {
-                    point_normal_collisions.emplace_back(
-                        cc.o1, cc.o2, col.point, col.normal, cc.notify1,
-                        cc.notify2);
-                }
+            for (planes::collision const& col : cols) {
+                point_normal_collisions.emplace_back(
+                    cc.o1, cc.o2, col.point, col.normal, col.depth,
+                    col.feature, cc.notify1, cc.notify2);
+            }
+        }
+    }
 
-                if (!cols.empty()) {
-                    continue;
-                }
+    // continuous collision detection where at least one object is swept
+    // note: the path of the objects during the frame is tested using relative
+    //       motion. objects that are not swept are assumed to have moved with
+    //       current velocity. the time of impact is recorded for the swept
+    //       objects which are moved to the earliest time of impact of all
+    //       their pairs before the collision is handled as a discrete
+    //       collision
+    auto process_swept_collision(sphere_collision const& cc) -> void {
+        object* o1 = cc.o1;
+        object* o2 = cc.o2;
+
+        float const dt = frame_context.dt;
+        swept_collision sc{.cc = cc,
+                           .o1_start = start_position(o1, dt),
+                           .o1_end = o1->position(),
+                           .o2_start = start_position(o2, dt),
+                           .o2_end = o2->position()};
+        // displacement of o1 relative to o2 during the frame
+        glm::vec3 const displacement =
+            (sc.o1_end - sc.o1_start) - (sc.o2_end - sc.o2_start);
+
+        bool const o1_is_sphere = o1->is_sphere;
+        bool const o2_is_sphere = o2->is_sphere;
+
+        if (o1_is_sphere == o2_is_sphere) {
+            // bounding sphere vs bounding sphere
+            std::optional<float> const toi = spheres_time_of_impact(
+                sc.o1_start - sc.o2_start, displacement,
+                o1->bounding_radius() + o2->bounding_radius());
+            if (!toi) {
+                return;
             }
+            // note: bounding spheres of volumes touch before the volumes do
+            sc.time = o1_is_sphere ? time_to_move_back_to(*toi)
+                                   : swept_planes_time_of_impact(
+                                         sc, *toi, glm::length(displacement));
+            add_swept_collision(sc);
+            return;
+        }
+
+        // sphere vs convex volume bounded by planes
+        // note: path of sphere is relative to the volume at end of frame
+        bool const o1_is_volume = o2_is_sphere;
+        object* volume = o1_is_volume ? o1 : o2;
+        object* sphere = o1_is_volume ? o2 : o1;
+        glm::vec3 const& volume_start =
+            o1_is_volume ? sc.o1_start : sc.o2_start;
+        glm::vec3 const& volume_end = o1_is_volume ? sc.o1_end : sc.o2_end;
+        glm::vec3 const& sphere_start =
+            o1_is_volume ? sc.o2_start : sc.o1_start;
+        glm::vec3 const path_start = volume_end + (sphere_start - volume_start);
+        glm::vec3 const path = o1_is_volume ? -displacement : displacement;
+
+        volume->update_planes_world_coordinates();
+        std::optional<planes::time_of_impact> const toi =
+            volume->planes.swept_sphere_time_of_impact(
+                path_start, path, sphere->bounding_radius());
+        if (!toi) {
+            return;
+        }
+
+        sc.time = time_to_move_back_to(toi->time);
+        sc.normal = toi->normal;
+        // point of sphere touching the plane relative to the volume
+        // note: sphere is touching the plane thus no penetration
+        sc.point = path_start + path * sc.time - volume_end -
+                   toi->normal * sphere->bounding_radius();
+        add_swept_collision(sc);
+    }
+
+    auto add_swept_collision(swept_collision const& sc) -> void {
+        if (sc.cc.o1->is_swept) {
+            slices.lower_time_of_impact(sc.cc.o1->slot(), sc.time);
+        }
+        if (sc.cc.o2->is_swept) {
+            slices.lower_time_of_impact(sc.cc.o2->slot(), sc.time);
         }
+        swept_collisions_vector.emplace_back(sc);
+    }
+
+    // called from one thread
+    // handles the pairs whose time of impact is the time the swept objects
+    // have been moved to
+    // note: a pair with a later time of impact than another pair of one of
+    //       its swept objects does not collide this frame
+    auto process_swept_collisions_vector() -> void {
+        for (swept_collision const& sc : swept_collisions_vector) {
+            object* o1 = sc.cc.o1;
+            object* o2 = sc.cc.o2;
+            if ((o1->is_swept &&
+                 slices.time_of_impact[o1->slot()] != sc.time) ||
+                (o2->is_swept &&
+                 slices.time_of_impact[o2->slot()] != sc.time)) {
+                continue;
+            }
+
+            bool const o1_is_sphere = o1->is_sphere;
+            bool const o2_is_sphere = o2->is_sphere;
+
+            if (o1_is_sphere && o2_is_sphere) {
+                sphere_collisions_vector.emplace_back(sc.cc);
+                continue;
+            }
+
+            if (!o1_is_sphere && !o2_is_sphere) {
+                process_planes_collision(sc.cc);
+                continue;
+            }
+
+            // o1 is the plane normal and o2 is the point
+            if (o2_is_sphere) {
+                point_normal_collisions.emplace_back(
+                    o1, o2, o1->position() + sc.point, sc.normal, 0,
+                    swept_contact_feature, sc.cc.notify1, sc.cc.notify2);
+            } else {
+                point_normal_collisions.emplace_back(
+                    o2, o1, o2->position() + sc.point, sc.normal, 0,
+                    swept_contact_feature, sc.cc.notify2, sc.cc.notify1);
+            }
+        }
+    }
+
+    // @return position of object at beginning of frame
+    static auto start_position(object const* o, float const dt) -> glm::vec3 {
+        if (o->is_swept || fixed_time_step) {
+            return o->previous_position();
+        }
+        return o->position() - o->linear_velocity() * dt;
+    }
+
+    // @return fraction of 'displacement' when the distance between the centers
+    //         is 'radius' or nullopt if the distance stays larger
+    static auto spheres_time_of_impact(glm::vec3 const& start,
+                                       glm::vec3 const& displacement,
+                                       float const radius)
+        -> std::optional<float> {
+
+        // solve |start + displacement * t| = radius for t
+        float const c = glm::dot(start, start) - radius * radius;
+        if (c <= 0) {
+            // in collision at the beginning of frame
+            return 0.0f;
+        }
+        float const a = glm::dot(displacement, displacement);
+        float const b = 2 * glm::dot(start, displacement);
+        float const discriminant = b * b - 4 * a * c;
+        if (a == 0 || b >= 0 || discriminant < 0) {
+            // not moving, moving away or not crossing
+            return std::nullopt;
+        }
+        float const t = (-b - std::sqrt(discriminant)) / (2 * a);
+        if (t > 1) {
+            return std::nullopt;
+        }
+        return t;
+    }
+
+    // note: objects in collision at beginning of frame are not moved back and
+    //       the collision is handled at end of frame as a discrete collision
+    static auto time_to_move_back_to(float const time_of_impact) -> float {
+        return time_of_impact > 0 ? time_of_impact : 1;
+    }
+
+    // swept volumes are advanced from the time the bounding spheres touch
+    // along their paths until the planes are in contact or the end of frame
+    // @return fraction of frame when the planes are in contact or 1
+    // note: a step is not longer than the shortest distance from the center
+    //       of a volume to its planes thus a thin volume is not stepped over
+    // note: the planes along the path are computed in local 'planes' thus
+    //       the objects are not changed
+    static auto swept_planes_time_of_impact(swept_collision const& sc, float t,
+                                            float const path_length)
+        -> float {
+        object const* o1 = sc.cc.o1;
+        object const* o2 = sc.cc.o2;
+        glm::vec3 const v12 = o1->linear_velocity() - o2->linear_velocity();
+        planes p1{};
+        planes p2{};
+        uint32_t steps = 0;
+        while (true) {
+            glm::vec3 const pos1 =
+                position_along_path(o1, sc.o1_start, sc.o1_end, t);
+            glm::vec3 const pos2 =
+                position_along_path(o2, sc.o2_start, sc.o2_end, t);
+            o1->planes_at(pos1, p1);
+            o2->planes_at(pos2, p2);
+            bool const is_in_contact =
+                !p1.points_planes_collisions(p2, v12).empty() ||
+                !p2.points_planes_collisions(p1, -v12).empty();
+            if (is_in_contact && t == 0) {
+                // volumes in contact at beginning of frame are handled at end
+                // of frame as a discrete collision
+                return 1;
+            }
+            if (is_in_contact || t >= 1) {
+                return std::min(t, 1.0f);
+            }
+            if (path_length <= 0 || steps == swept_max_steps) {
+                return 1;
+            }
+            float const step_length =
+                std::min(p1.distance_to_nearest_plane(pos1),
+                         p2.distance_to_nearest_plane(pos2));
+            float const min_step = (1 - t) / float(swept_max_steps - steps);
+            t = std::min(1.0f,
+                         t + std::max(step_length / path_length, min_step));
+            ++steps;
+        }
+    }
+
+    // @return position of object at fraction 't' of its path during the frame
+    // note: objects that are not swept stay at the end of the path
+    static auto position_along_path(object const* o, glm::vec3 const& start,
+                                    glm::vec3 const& end, float const t)
+        -> glm::vec3 {
+        return o->is_swept ? start + (end - start) * t : end;
+    }
+
+    // moves a swept object to its earliest time of impact
+    // note: model-to-world matrix is rebuilt thus planes are at the new
+    //       position when next updated to world coordinates
+    static auto move_to_time_of_impact(object* o, glm::vec3 const& start,
+                                       glm::vec3 const& end) -> void {
+        if (!o->is_swept) {
+            return;
+        }
+        o->position() = position_along_path(
+            o, start, end, slices.time_of_impact[o->slot()]);
+        o->update_Mmw();
     }
 
     // called from one thread
@@ -333,159 +649,53 @@ class cell final {
             }
         }
 
-        // both objects are not spheres
-        for (uint32_t i = 0; i < 4; ++i) {
-            for (point_normal_collision const& pnc : point_normal_collisions) {
-                object* o1 = pnc.o1;
-                object* o2 = pnc.o2;
-
-                bool const o1_handled_o2 =
-                    pnc.notify1 ? dispatch_collision(o1, o2) : false;
-                bool const o2_handled_o1 =
-                    pnc.notify2 ? dispatch_collision(o2, o1) : false;
-
-                // check if collision has already been handled, possibly on
-                // a different thread in a different cell
-                std::print("cell: {}    o1: {}    o2: {}    n: {}    p: {}\n",
-                           static_cast<void const*>(this), o1->name, o2->name,
-                           glm::to_string(pnc.normal),
-                           glm::to_string(pnc.point));
-
-                // collision has not been handled during this frame by
-                // any cell
-                handle_rigid_bodies_collision(o1, o2, pnc.normal, pnc.point);
-            }
-        }
-    }
-
-    static auto handle_rigid_bodies_collision(object* o1, object* o2,
-                                              glm::vec3 const& normal,
-                                              glm::vec3 const& point) -> void {
-        // synchronize objects that overlap cells
-        bool const o1_overlaps_cells = o1->overlaps_cells;
-        bool const o2_overlaps_cells = o2->overlaps_cells;
-
-        if (threaded_grid && o1_overlaps_cells) {
-            o1->acquire_lock();
-        }
-        if (threaded_grid && o2_overlaps_cells) {
-            o2->acquire_lock();
-        }
-
-        // impulse-based collision response from
-        // https://en.wikipedia.org/wiki/collision_response
-
-        // contact normal points from o1 towards o2
-
-        // offset from center of mass to contact point
-        glm::vec3 const r1 = point - o1->position;
-        glm::vec3 const r2 = point - o2->position;
-
-        // get world-space inverse inertia tensors for both objects
-        glm::mat3 const InvI1w = o1->updated_invIw();
-        glm::mat3 const InvI2w = o2->updated_invIw();
-
-        // velocity at contact point: v_p = v + ω × r
-        glm::vec3 const v_p1 =
-            o1->linear_velocity + glm::cross(o1->angular_velocity, r1);
-        glm::vec3 const v_p2 =
-            o2->linear_velocity + glm::cross(o2->angular_velocity, r2);
-
-        // relative velocity at contact point
-        glm::vec3 const relative_velocity = v_p2 - v_p1;
-
-        // relative velocity along contact normal
-        float const relative_velocity_along_normal =
-            glm::dot(relative_velocity, normal);
-
-        // if objects are separating, no collision response needed
-        if (relative_velocity_along_normal >= 0) {
-            if (threaded_grid && o2_overlaps_cells) {
-                o2->release_lock();
+        // contacts with convex volumes
+        // note: collision response is done by 'solver' after all cells
+        for (point_normal_collision const& pnc : point_normal_collisions) {
+            object* o1 = pnc.o1;
+            object* o2 = pnc.o2;
+            if (pnc.notify1) {
+                dispatch_collision(o1, o2);
             }
-            if (threaded_grid && o1_overlaps_cells) {
-                o1->release_lock();
+            if (pnc.notify2) {
+                dispatch_collision(o2, o1);
             }
-            return;
-        }
-
-        // coefficient of restitution (elasticity)
-        // 0 = inelastic (objects stick), 1 = elastic (bouncy)
-        // float constexpr restitution = 1.0f;
-        float constexpr restitution = 1.0f;
-
-        // impulse magnitude calculation using actual inertia tensors
-        // j_r = -(1 + e) * (v_r · n) / (m1^-1 + m2^-1 + (I1^-1(r1 × n) × r1
-        // + I2^-1(r2 × n) × r2) · n)
-
-        // compute rotational components using inertia tensors
-        glm::vec3 const r1_cross_n = glm::cross(r1, normal);
-        glm::vec3 const r2_cross_n = glm::cross(r2, normal);
-
-        glm::vec3 const inertia_term1 = glm::cross(InvI1w * r1_cross_n, r1);
-        glm::vec3 const inertia_term2 = glm::cross(InvI2w * r2_cross_n, r2);
-
-        float const rotational_term =
-            glm::dot(inertia_term1 + inertia_term2, normal);
-        float const inv_mass_sum = o1->invMass + o2->invMass;
-
-        float const impulse_magnitude = -(1.0f + restitution) *
-                                        relative_velocity_along_normal /
-                                        (inv_mass_sum + rotational_term);
-
-        // impulse vector
-        glm::vec3 const impulse = impulse_magnitude * normal;
-
-        // apply impulse to linear velocities
-        // v'_1 = v_1 - j_r / m1
-        // v'_2 = v_2 + j_r / m2
-        o1->linear_velocity -= impulse * o1->invMass;
-        o2->linear_velocity += impulse * o2->invMass;
-
-        // apply impulse to angular velocities
-        // ω'_1 = ω_1 - I_1^-1 (r_1 × j_r)
-        // ω'_2 = ω_2 + I_2^-1 (r_2 × j_r)
-        glm::vec3 const torque1 = glm::cross(r1, impulse);
-        glm::vec3 const torque2 = glm::cross(r2, impulse);
-
-        o1->angular_velocity -= InvI1w * torque1;
-        o2->angular_velocity += InvI2w * torque2;
-
-        if (threaded_grid && o2_overlaps_cells) {
-            o2->release_lock();
-        }
-        if (threaded_grid && o1_overlaps_cells) {
-            o1->release_lock();
         }
     }
 
     static auto handle_sphere_collision(object* o1, object* o2) -> void {
         // synchronize objects that overlap cells
+        // note: locks are acquired in order of address because other cells
+        //       may handle the same objects in a different order
 
-        bool const o1_overlaps_cells = o1->overlaps_cells;
-        bool const o2_overlaps_cells = o2->overlaps_cells;
+        object* const first = std::less<object*>{}(o1, o2) ? o1 : o2;
+        object* const second = first == o1 ? o2 : o1;
+        bool const first_overlaps_cells = first->overlaps_cells;
+        bool const second_overlaps_cells = second->overlaps_cells;
 
-        if (threaded_grid && o1_overlaps_cells) {
-            o1->acquire_lock();
+        if (threaded_grid && first_overlaps_cells) {
+            first->acquire_lock();
         }
-        if (threaded_grid && o2_overlaps_cells) {
-            o2->acquire_lock();
+        if (threaded_grid && second_overlaps_cells) {
+            second->acquire_lock();
         }
 
+        object::propagate_rest_state(o1, o2);
+
         glm::vec3 const collision_normal =
-            glm::normalize(o2->position - o1->position);
+            glm::normalize(o2->position() - o1->position());
 
         float const relative_velocity_along_collision_normal = glm::dot(
-            o2->linear_velocity - o1->linear_velocity, collision_normal);
+            o2->linear_velocity() - o1->linear_velocity(), collision_normal);
 
         if (relative_velocity_along_collision_normal >= 0 ||
             std::isnan(relative_velocity_along_collision_normal)) {
             // spheres are not moving towards each other
-            if (threaded_grid && o2_overlaps_cells) {
-                o2->release_lock();
+            if (threaded_grid && second_overlaps_cells) {
+                second->release_lock();
             }
-            if (threaded_grid && o1_overlaps_cells) {
-                o1->release_lock();
+            if (threaded_grid && first_overlaps_cells) {
+                first->release_lock();
             }
             return;
         }
@@ -495,16 +705,16 @@ class cell final {
         float constexpr restitution = 1;
         float const impulse = (1.0f + restitution) *
                               relative_velocity_along_collision_normal /
-                              (o1->mass_ + o2->mass_);
+                              (o1->mass() + o2->mass());
 
-        o1->linear_velocity += impulse * o2->mass_ * collision_normal;
-        o2->linear_velocity -= impulse * o1->mass_ * collision_normal;
+        o1->linear_velocity() += impulse * o2->mass() * collision_normal;
+        o2->linear_velocity() -= impulse * o1->mass() * collision_normal;
 
-        if (threaded_grid && o2_overlaps_cells) {
-            o2->release_lock();
+        if (threaded_grid && second_overlaps_cells) {
+            second->release_lock();
         }
-        if (threaded_grid && o1_overlaps_cells) {
-            o1->release_lock();
+        if (threaded_grid && first_overlaps_cells) {
+            first->release_lock();
         }
     }
 
@@ -547,6 +757,39 @@ class cell final {
         return false;
     }
 
+    // @return true if the objects are moving away from each other at all
+    //         possible contact points
+    // note: velocity at a contact point differs from the linear velocity by
+    //       at most angular speed times bounding radius
+    static auto are_separating(entry const& ce1, entry const& ce2) -> bool {
+        object const* o1 = ce1.object;
+        object const* o2 = ce2.object;
+
+        if (o1->is_swept || o2->is_swept) {
+            // entry is the bounding sphere of the path and the center may
+            // already be past the other object
+            return false;
+        }
+
+        // vector from center of o1 to center of o2
+        glm::vec3 const d = ce2.position - ce1.position;
+
+        // relative velocity along 'd' scaled by length of 'd'
+        float const separating_velocity_times_distance =
+            glm::dot(o2->linear_velocity() - o1->linear_velocity(), d);
+
+        if (separating_velocity_times_distance <= 0) {
+            return false;
+        }
+
+        float const max_rotational_velocity =
+            glm::length(o1->angular_velocity()) * ce1.radius +
+            glm::length(o2->angular_velocity()) * ce2.radius;
+
+        return separating_velocity_times_distance >
+               max_rotational_velocity * glm::length(d);
+    }
+
     static auto bounding_spheres_are_in_collision(entry const& ce1,
                                                   entry const& ce2) -> bool {
 
@@ -15,6 +15,14 @@ class frame_context final {
     float dt = 0;    // frame delta time in seconds (time step)
 } static frame_context{};
 
+// information about the current rendered frame
+class render_context final {
+  public:
+    uint64_t frame_num = 0; // rendered frame number (will rollover)
+    float alpha = 1; // interpolation between previous and current simulation
+                     // state when 'fixed_time_step'
+} static render_context{};
+
 // signal bit corresponding to keyboard key (max 64)
 static uint32_t constexpr key_w = 1u << 0u;
 static uint32_t constexpr key_a = 1u << 1u;
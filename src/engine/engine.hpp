@@ -11,13 +11,16 @@
 #include "globs.hpp"
 #include "grid.hpp"
 #include "hud.hpp"
+#include "jobs.hpp"
 #include "materials.hpp"
 #include "metrics.hpp"
 #include "net.hpp"
 #include "objects.hpp"
+#include "render_states.hpp"
 #include "sdl.hpp"
 #include "shaders.hpp"
 #include "textures.hpp"
+#include "topology.hpp"
 #include "window.hpp"
 #include <GLES3/gl3.h>
 #include <SDL3/SDL.h>
@@ -25,6 +28,7 @@
 #include <SDL3_image/SDL_image.h>
 #include <SDL3_ttf/SDL_ttf.h>
 #include <arpa/inet.h>
+#include <cmath>
 #include <condition_variable>
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/glm.hpp>
@@ -63,7 +67,7 @@ static glm::vec3 background_color{0, 0, 0};
 static glm::vec3 ambient_light = glm::normalize(glm::vec3{0, 1, 1});
 
 // object the camera should follow
-static object* camera_follow_object = nullptr;
+static o1handle camera_follow_object{};
 
 // mouse settings
 static float constexpr mouse_rad_over_pixels =
@@ -81,6 +85,7 @@ class engine final {
 
         // initiate subsystems, order matters
         metrics.init();
+        topology.init();
         net.init();
         sdl.init();
         window.init();
@@ -91,6 +96,8 @@ class engine final {
         globs.init();
         objects.init();
         grid.init();
+        solver.init();
+        init_update_jobs();
 
         // line rendering shader
         {
@@ -159,10 +166,7 @@ void main() {
         printf(":-%15s-:-%-9s-:\n", "---------------", "---------");
         puts("");
 
-        if (threaded_grid) {
-            printf("threaded grid on %u cores\n\n",
-                   std::thread::hardware_concurrency());
-        }
+        topology.print(stdout);
 
         // the bounding sphere used for debugging
         glob_ix_bounding_sphere =
@@ -191,7 +195,17 @@ void main() {
     }
 
     auto free() -> void {
+        if (objects_print_high_water_marks) {
+            objects.print_high_water_marks(stdout);
+        }
+
+        if (update_jobs_print_times) {
+            update_jobs.print_times(stdout);
+        }
+        update_jobs.free();
+
         application_free();
+        solver.free();
         grid.free();
         objects.free();
         globs.free();
@@ -202,6 +216,7 @@ void main() {
         window.free();
         sdl.free();
         net.free();
+        topology.free();
         metrics.free();
     }
 
@@ -211,7 +226,10 @@ void main() {
             net.begin();
         }
 
-        if (threaded_update) {
+        if (threaded_update_pipelined) {
+            // update runs as separate thread one frame ahead of render
+            start_pipelined_update_thread();
+        } else if (threaded_update) {
             // update runs as separate thread
             start_update_thread();
         }
@@ -234,7 +252,14 @@ void main() {
                 break;
             }
 
-            if (threaded_update) {
+            if (threaded_update_pipelined) {
+                // update runs in separate thread
+                if (render_state const* rs = render_states.take()) {
+                    render(rs);
+                    window.swap_buffers();
+                    metrics.allocated_objects = rs->allocated_objects;
+                }
+            } else if (threaded_update) {
                 // update runs in separate thread
                 render_thread_loop_body();
             } else {
@@ -242,20 +267,35 @@ void main() {
                 render();
 
                 metrics.update_begin();
-                update_pass_1();
-                update_pass_2();
+                uint32_t const ticks = simulation_ticks();
+                for (uint32_t i = 0; i < ticks; ++i) {
+                    update_pass_1();
+                    update_pass_2();
+                }
                 metrics.update_end();
 
                 // swap buffers after update to allow debugging rendering
                 window.swap_buffers();
             }
 
-            metrics.allocated_objects = uint32_t(objects.allocated_list_len());
+            if (!threaded_update_pipelined) {
+                metrics.allocated_objects =
+                    uint32_t(objects.allocated_list_len());
+            }
+            metrics.store_contention = objects.take_store_contention_count();
+            if (spinlock_counters_enabled) {
+                spinlock_counters.take(metrics.lock_acquisitions,
+                                       metrics.lock_spins);
+            }
             metrics.at_frame_end(stdout);
         }
 
         // exit
-        if (threaded_update) {
+        if (threaded_update_pipelined) {
+            // wake update thread incase it is waiting
+            render_states.stop();
+            update_thread.join();
+        } else if (threaded_update) {
             // trigger update thread incase it is waiting
             std::unique_lock<std::mutex> lock{is_rendering_mutex};
             is_rendering = false;
@@ -292,13 +332,25 @@ void main() {
     // index of previous shader
     uint32_t shader_program_ix_prv = shader_program_ix;
 
+    // simulation time not yet simulated when 'fixed_time_step'
+    float simulation_time_accumulator = 0;
+
     // synchronization of update and render thread
     std::thread update_thread{};
     bool is_rendering = true;
     std::mutex is_rendering_mutex{};
     std::condition_variable is_rendering_cv{};
+    // frames handed from update to render thread when
+    // 'threaded_update_pipelined'
+    render_states render_states{};
+
+    // stages of 'update_pass_2'
+    jobs update_jobs{};
+
+    // @param rs state rendered instead of 'grid' or nullptr
+    auto render(render_state const* rs = nullptr) -> void {
+        ++render_context.frame_num;
 
-    auto render() -> void {
         metrics.render_begin();
         if (!is_render) {
             metrics.render_end();
@@ -312,8 +364,12 @@ void main() {
             shader_program_ix_prv = shader_program_ix;
         }
 
-        if (camera_follow_object) {
-            camera.look_at = camera_follow_object->position;
+        if (rs) {
+            if (rs->is_camera_following) {
+                camera.look_at = rs->camera_look_at;
+            }
+        } else if (object const* o = objects.lookup(camera_follow_object)) {
+            camera.look_at = o->position();
         }
 
         camera.update_matrix_wvp();
@@ -334,9 +390,18 @@ void main() {
             shaders.use_program(shader_program_ix);
         }
 
-        grid.render();
+        if (rs) {
+            for (render_state::entry const& e : rs->entries) {
+                globs.at(e.glob_ix).render(e.Mmw);
+                ++metrics.rendered_objects;
+            }
+        } else {
+            grid.render();
+        }
 
         if (is_render_grid) {
+            // note: renders the cell layout from configuration thus does not
+            //       read the grid that update is modifying
             grid.debug_render_grid();
         }
 
@@ -348,90 +413,157 @@ void main() {
     // in 'threaded_update' runs before render and update is done parallel in
     //  'update_pass_2()'
     auto update_pass_1() -> void {
-
-        grid.clear_non_static_entries();
-
-        // add all allocated non static objects to the grid
-        objects.for_each([](object* o) {
-            if (!o->is_static()) {
-                grid.add(o);
-            }
-        });
-
         // update frame context used throughout the frame
         //  in multiplayer mode use 'dt' and 'ms' from server
         //   in single player mode use 'dt' from previous frame and current 'ms'
         ++frame_num;
         if (net.enabled) {
             frame_context = {frame_num, net.ms, net.dt};
+        } else if (fixed_time_step) {
+            frame_context = {frame_num, SDL_GetTicks(),
+                             1.0f / simulation_tick_rate};
         } else {
             frame_context = {frame_num, SDL_GetTicks(), metrics.dt};
         }
+
+        if (objects_compact_interval_frames &&
+            frame_num % objects_compact_interval_frames == 0) {
+            // note: before objects are added to grid so that the cells get
+            //       the objects in the compacted order
+            objects.compact([](object const* o) {
+                return grid::morton_code(o->position());
+            });
+        }
+
+        grid.clear_non_static_entries();
+
+        // add all allocated non static objects to the grid
+        // note: after frame context is updated because swept objects are added
+        //       using 'dt'
+        if (threaded_grid &&
+            objects.allocated_list_len() >= grid_add_parallel_min_objects) {
+            grid.add_parallel();
+        } else {
+            objects.for_each([](object* o) {
+                if (!o->is_static()) {
+                    grid.add(o);
+                }
+            });
+        }
+    }
+
+    // @return number of simulation ticks to run this frame
+    auto simulation_ticks() -> uint32_t {
+        if (!fixed_time_step || net.enabled) {
+            return 1;
+        }
+
+        float constexpr tick_dt = 1.0f / simulation_tick_rate;
+
+        simulation_time_accumulator += metrics.dt;
+
+        uint32_t ticks = uint32_t(simulation_time_accumulator / tick_dt);
+        if (ticks > simulation_max_ticks_per_frame) {
+            // simulation cannot keep up; drop the simulation time that would
+            // need more ticks than allowed
+            ticks = simulation_max_ticks_per_frame;
+            simulation_time_accumulator =
+                float(ticks) * tick_dt +
+                std::fmod(simulation_time_accumulator, tick_dt);
+        }
+
+        simulation_time_accumulator -= float(ticks) * tick_dt;
+
+        // render interpolates between previous and current simulation state
+        render_context.alpha = simulation_time_accumulator / tick_dt;
+
+        return ticks;
     }
 
     // in 'threaded_update' runs in parallel with rendering
-    auto update_pass_2() const -> void {
+    auto update_pass_2() -> void {
         if (is_print_grid) {
             grid.print();
         }
 
         // note: data racing between render and update thread on objects
-        //       position, angle, scale glob index is ok (?)
+        //       position, angle, scale, glob index is ok (?)
+        // note: render thread reads the model-to-world matrices buffered in
+        //       'update_pass_1' thus the batched pass does not race
 
-        grid.update();
+        update_jobs.run();
 
-        if (is_resolve_collisions) {
-            grid.resolve_collisions();
-        }
+        // callback application and apply changes done by application
+        // note: on update thread after the jobs are done because the
+        //       application is not thread safe and may allocate and free
+        //       objects which may not be done while instances are applied
+        application_on_update_done();
+        apply_freed_and_allocated_instances();
 
-        // remove freed static objects from grid
-        // note: at 'update()' and 'resolve_collisions()' objects might be freed
-        // and created. same with destructors of freed objects
-        objects.apply_freed_instances([](object* o) {
-            if (o->is_static()) {
-                grid.remove_static(o);
-            }
-        });
+        // update signals from network or local
+        // note: last in the frame because objects during update and collision
+        //       handling and the application read the signals of the current
+        //       frame thus the lockstep order of multiplayer is kept
+        if (net.enabled) {
+            // receive signals from previous frame and send signals of current
+            // frame
+            net.receive_and_send();
+        } else {
+            // copy signals to active player
+            net.states[net.player_ix] = net.next_state;
+        }
+    }
 
-        // add newly allocated static objects to grid
-        objects.apply_allocated_instances([](object* o) {
-            if (o->is_static()) {
-                grid.add_static(o);
-            }
-        });
+    // declares the stages of 'update_pass_2' and their dependencies
+    auto init_update_jobs() -> void {
+        // integrate motion of objects with default motion in one batch
+        uint32_t const integrate = update_jobs.add(
+            "integrate motion", {}, [] { objects.integrate_motion(); });
+
+        // update objects type by type
+        uint32_t const update =
+            update_jobs.add("update", {integrate}, [] { objects.update(); });
+
+        // rebuild model-to-world matrices of moved objects in one batch used
+        // by collision detection and render
+        uint32_t const matrices = update_jobs.add(
+            "update matrices", {update}, [] { objects.update_Mmw_matrices(); });
+
+        uint32_t const collisions =
+            update_jobs.add("resolve collisions", {matrices}, [this] {
+                if (is_resolve_collisions) {
+                    grid.resolve_collisions();
+                }
+            });
 
-        // callback application
-        application_on_update_done();
+        // note: at 'update()' and 'resolve_collisions()' objects might be
+        //       freed and created. same with destructors of freed objects
+        update_jobs.add("apply instances", {collisions},
+                        [] { apply_freed_and_allocated_instances(); });
 
-        // apply changes done by application
+        update_jobs.init(update_jobs_threads, workers_spin_us,
+                         [] { topology.pin_worker_thread(); });
+    }
 
-        // removed freed static objects from grid
+    // removes freed static objects from grid and adds newly allocated
+    static auto apply_freed_and_allocated_instances() -> void {
         objects.apply_freed_instances([](object* o) {
             if (o->is_static()) {
                 grid.remove_static(o);
             }
         });
 
-        // add newly allocated static objects to grid
         objects.apply_allocated_instances([](object* o) {
             if (o->is_static()) {
                 grid.add_static(o);
             }
         });
-
-        // update signals from network or local
-        if (net.enabled) {
-            // receive signals from previous frame and send signals of current
-            // frame
-            net.receive_and_send();
-        } else {
-            // copy signals to active player
-            net.states[net.player_ix] = net.next_state;
-        }
     }
 
     auto start_update_thread() -> void {
         update_thread = std::thread([this]() {
+            topology.pin_update_thread();
+            uint32_t ticks = 0;
             while (true) {
                 {
                     // wait until render thread is done before removing and
@@ -448,7 +580,23 @@ void main() {
 
                     metrics.update_begin();
 
-                    update_pass_1();
+                    ticks = simulation_ticks();
+
+                    if (ticks > 0) {
+                        // ticks other than the last run while render waits
+                        for (uint32_t i = 1; i < ticks; ++i) {
+                            update_pass_1();
+                            update_pass_2();
+                        }
+
+                        update_pass_1();
+                    }
+
+                    // matrices read by render thread while update pass 2
+                    // rewrites them
+                    // note: after 'simulation_ticks' which sets the
+                    //       interpolation of fixed time step
+                    objects.buffer_rendered_matrices();
 
                     // notify render thread to start rendering
                     is_rendering = true;
@@ -456,14 +604,58 @@ void main() {
                     is_rendering_cv.notify_one();
                 }
 
-                // running in parallel with render thread
-                update_pass_2();
+                if (ticks > 0) {
+                    // running in parallel with render thread
+                    update_pass_2();
+                }
 
                 metrics.update_end();
             }
         });
     }
 
+    // update of frame N + 1 runs while render thread renders frame N
+    // note: objects are not accessed by render thread, instead the state to
+    //       render is copied at the end of update and handed to render thread
+    // note: update waits only when it is a frame ahead of render
+    auto start_pipelined_update_thread() -> void {
+        update_thread = std::thread([this]() {
+            topology.pin_update_thread();
+            while (true) {
+                metrics.update_begin();
+                uint32_t const ticks = simulation_ticks();
+                for (uint32_t i = 0; i < ticks; ++i) {
+                    update_pass_1();
+                    update_pass_2();
+                }
+                copy_render_state(render_states.back());
+                metrics.update_end();
+
+                if (!render_states.publish()) {
+                    return;
+                }
+            }
+        });
+    }
+
+    // called from update thread when 'threaded_update_pipelined'
+    // note: the rendered matrix and glob of every allocated object are
+    //       captured, not what 'grid.render()' would render, thus overrides of
+    //       'object::render()' are bypassed and objects are not culled to the
+    //       grid
+    static auto copy_render_state(render_state& rs) -> void {
+        rs.allocated_objects = uint32_t(objects.allocated_list_len());
+        rs.entries.clear();
+        objects.for_each([&rs](object const* o) {
+            rs.entries.push_back({o->rendered_Mmw(), o->glob_ix()});
+        });
+        object const* o = objects.lookup(camera_follow_object);
+        rs.is_camera_following = o != nullptr;
+        if (o) {
+            rs.camera_look_at = o->position();
+        }
+    }
+
     auto render_thread_loop_body() -> void {
         // wait for update thread to remove and add objects to grid
         std::unique_lock<std::mutex> lock{is_rendering_mutex};
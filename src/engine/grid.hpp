@@ -8,6 +8,7 @@
 // reviewed: 2024-07-08
 
 #include "cell.hpp"
+#include "solver.hpp"
 #include <execution>
 
 // if enabled implementation of parallelization is done with a jthread per row
@@ -17,77 +18,76 @@
 namespace glos {
 
 class grid final {
+    static uint32_t constexpr cells_count = grid_rows * grid_columns;
+
     std::array<std::array<cell, grid_columns>, grid_rows> cells{};
 
+    // entry added to a cell by 'add_parallel'
+    // note: 'list_ix' is cell index times 2 plus 1 if object is sleeping
+    struct bin_entry final {
+        uint32_t list_ix = 0;
+        float radius = 0;
+        object* object = nullptr;
+        glm::vec3 center{};
+    };
+
+    // objects added by a worker in 'add_parallel' and the entries they add
+    struct bin final {
+        object** begin = nullptr;
+        object** end = nullptr;
+        std::vector<bin_entry> entries{}; // in the order of 'add'
+        // number of entries per cell list then index of next entry
+        std::array<uint32_t, cells_count * 2> counts{};
+    };
+
+    std::vector<bin> bins{};
+
   public:
     auto init() -> void {}
 
     auto free() -> void {}
 
     // called from engine
-    auto update() -> void {
-        if (threaded_grid) {
-#if defined(MODE_JTHREADS)
-            std::vector<std::jthread> workers;
-            workers.reserve(grid_rows);
-            for (auto const& row : cells) {
-                workers.emplace_back([&row] {
-                    for (cell const& c : row) {
-                        c.update();
-                    }
-                });
+    auto resolve_collisions() -> void {
+        run_on_cells([](cell& c) { c.find_collisions(); });
+
+        // note: swept objects are moved once, after all cells, to the
+        //       earliest time of impact found by any cell
+        for (auto const& row : cells) {
+            for (cell const& c : row) {
+                c.move_swept_objects_to_time_of_impact();
             }
-#else
-            // note: not `par_unseq` because that mode does not allow
-            //       concurrency
-            std::for_each(std::execution::par, std::cbegin(cells),
-                          std::cend(cells), [](auto const& row) {
-                              for (cell const& c : row) {
-                                  c.update();
-                              }
-                          });
-#endif
-            return;
         }
 
+        run_on_cells([](cell& c) { c.handle_collisions(); });
+
         for (auto const& row : cells) {
             for (cell const& c : row) {
-                c.update();
+                c.clear_swept_time_of_impact();
             }
         }
-    }
 
-    // called from engine
-    auto resolve_collisions() -> void {
-        if (threaded_grid) {
-#if defined(MODE_JTHREADS)
-            std::vector<std::jthread> workers;
-            workers.reserve(grid_rows);
-            for (auto& row : cells) {
-                workers.emplace_back([&row] {
-                    for (cell& c : row) {
-                        c.resolve_collisions();
-                    }
-                });
+        // note: counted by cells and summed here to avoid contention on
+        //       'metrics' when multithreaded
+        // note: a pair of objects that overlap several cells is counted in
+        //       each cell
+        uint32_t culled_pairs = 0;
+        for (auto const& row : cells) {
+            for (cell const& c : row) {
+                culled_pairs += c.culled_pairs_count();
             }
-#else
-            // note: not `par_unseq` because that mode does not allow
-            //       concurrency
-            std::for_each(std::execution::par, std::begin(cells),
-                          std::end(cells), [](auto& row) {
-                              for (cell& c : row) {
-                                  c.resolve_collisions();
-                              }
-                          });
-            return;
-#endif
         }
+        metrics.culled_pairs = culled_pairs;
 
-        for (auto& row : cells) {
-            for (cell& c : row) {
-                c.resolve_collisions();
+        // respond to contacts found by cells
+        // note: contacts are added in the order of cells for deterministic
+        //       result in multiplayer mode
+        for (auto const& row : cells) {
+            for (cell const& c : row) {
+                c.add_contacts_to_solver();
             }
         }
+        solver.solve();
     }
 
     // called from engine
@@ -110,10 +110,72 @@ class grid final {
 
     // called from engine
     auto add(object* o) -> void {
+        if (o->is_swept) {
+            add_swept(o);
+            return;
+        }
         o->overlaps_cells =
             for_each_cell_object_is_in(o, [o](cell& c) { c.add(o); });
     }
 
+    // called from engine
+    // adds the non-static allocated objects in parallel
+    // note: workers bin the entries of chunks of objects then the entries are
+    //       placed in the cells at offsets given by a prefix sum of the counts
+    //       of the bins. the cells get the same entries in the same order as
+    //       calling 'add' on the objects in the order of 'objects.for_each'
+    auto add_parallel() -> void {
+        uint32_t bins_len = 0;
+        objects.for_each_list([this, &bins_len](object** begin,
+                                                object** const end) {
+            while (begin < end) {
+                object** const bin_end =
+                    begin + std::min(ptrdiff_t(grid_add_parallel_chunk_size),
+                                     end - begin);
+                if (bins_len == bins.size()) {
+                    bins.emplace_back();
+                }
+                bins[bins_len].begin = begin;
+                bins[bins_len].end = bin_end;
+                ++bins_len;
+                begin = bin_end;
+            }
+        });
+        auto const bins_end = bins.begin() + bins_len;
+
+        std::for_each(std::execution::par, bins.begin(), bins_end,
+                      [this](bin& b) { fill_bin(b); });
+
+        // reserve entries in the cells and turn the counts into indexes
+        for (uint32_t i = 0; i < cells_count; ++i) {
+            uint32_t moving_count = 0;
+            uint32_t sleeping_count = 0;
+            for (auto it = bins.begin(); it < bins_end; ++it) {
+                moving_count += it->counts[i * 2];
+                sleeping_count += it->counts[i * 2 + 1];
+            }
+            auto [moving_ix, sleeping_ix] =
+                cell_at(i).append_entries(moving_count, sleeping_count);
+            for (auto it = bins.begin(); it < bins_end; ++it) {
+                uint32_t const moving = it->counts[i * 2];
+                uint32_t const sleeping = it->counts[i * 2 + 1];
+                it->counts[i * 2] = moving_ix;
+                it->counts[i * 2 + 1] = sleeping_ix;
+                moving_ix += moving;
+                sleeping_ix += sleeping;
+            }
+        }
+
+        std::for_each(std::execution::par, bins.begin(), bins_end,
+                      [this](bin& b) {
+                          for (bin_entry const& e : b.entries) {
+                              cell_at(e.list_ix / 2)
+                                  .set_entry(b.counts[e.list_ix]++, e.object,
+                                             e.center, e.radius);
+                          }
+                      });
+    }
+
     auto add_static(object* o) -> void {
         o->overlaps_cells =
             for_each_cell_object_is_in(o, [o](cell& c) { c.add_static(o); });
@@ -134,7 +196,9 @@ class grid final {
         printf("------------------------\n");
     }
 
-    auto debug_render_grid() const -> void {
+    // note: static because it renders only the layout given by configuration
+    //       thus it may be called from render thread while update runs
+    static auto debug_render_grid() -> void {
         float constexpr gw = grid_cell_size * grid_columns;
         float constexpr gh = grid_cell_size * grid_rows;
         for (float z = -gh / 2; z <= gh / 2; z += grid_cell_size) {
@@ -147,7 +211,79 @@ class grid final {
         }
     }
 
+    // @return key that orders positions by cell in Morton (Z) order and
+    //         within a cell by Morton order of the position in the cell
+    // note: used to compact 'objects' so that objects in the same cell are
+    //       close in memory
+    static auto morton_code(glm::vec3 const& p) -> uint64_t {
+        float constexpr gw = grid_cell_size * grid_columns;
+        float constexpr gh = grid_cell_size * grid_rows;
+        float constexpr sub_cells = 1 << morton_sub_cell_bits;
+
+        float const x = (gw / 2 + p.x) / grid_cell_size;
+        float const z = (gh / 2 + p.z) / grid_cell_size;
+        uint32_t const xi = clamp(int32_t(x), grid_columns - 1);
+        uint32_t const zi = clamp(int32_t(z), grid_rows - 1);
+        uint32_t const xs = clamp(int32_t((x - float(xi)) * sub_cells),
+                                  uint32_t(sub_cells) - 1);
+        uint32_t const zs = clamp(int32_t((z - float(zi)) * sub_cells),
+                                  uint32_t(sub_cells) - 1);
+
+        return (uint64_t(interleave_bits(xi, zi)) << 2 * morton_sub_cell_bits) |
+               interleave_bits(xs, zs);
+    }
+
   private:
+    // calls 'func(cell&)' on each cell, rows in parallel when 'threaded_grid'
+    auto run_on_cells(auto&& func) -> void {
+        if (threaded_grid) {
+#if defined(MODE_JTHREADS)
+            std::vector<std::jthread> workers;
+            workers.reserve(grid_rows);
+            for (auto& row : cells) {
+                workers.emplace_back([&row, &func] {
+                    for (cell& c : row) {
+                        func(c);
+                    }
+                });
+            }
+#else
+            // note: not `par_unseq` because that mode does not allow
+            //       concurrency
+            std::for_each(std::execution::par, std::begin(cells),
+                          std::end(cells), [&func](auto& row) {
+                              for (cell& c : row) {
+                                  func(c);
+                              }
+                          });
+#endif
+        } else {
+            for (auto& row : cells) {
+                for (cell& c : row) {
+                    func(c);
+                }
+            }
+        }
+    }
+
+    // resolution of position in cell used by 'morton_code'
+    static uint32_t constexpr morton_sub_cell_bits = 10;
+
+    // @return bits of 'x' and 'z' interleaved with 'x' in the even bits
+    // note: 16 lower bits of 'x' and 'z' are used
+    static auto interleave_bits(uint32_t const x, uint32_t const z)
+        -> uint32_t {
+        auto const spread = [](uint32_t v) {
+            v &= 0x0000ffff;
+            v = (v | (v << 8)) & 0x00ff00ff;
+            v = (v | (v << 4)) & 0x0f0f0f0f;
+            v = (v | (v << 2)) & 0x33333333;
+            v = (v | (v << 1)) & 0x55555555;
+            return v;
+        };
+        return spread(x) | (spread(z) << 1);
+    }
+
     static auto clamp(int32_t const i, uint32_t const max) -> uint32_t {
         if (i < 0) {
             return 0;
@@ -158,18 +294,109 @@ class grid final {
         return uint32_t(i);
     }
 
+    // adds the capsule swept by the bounding sphere of the object during the
+    // frame to the cells it crosses
+    // note: the end position is predicted using the velocity and acceleration
+    //       at the beginning of the frame, same as the integration in
+    //       'object::update'
+    auto add_swept(object* o) -> void {
+        swept_bounds const sb = swept_bounds_of(o);
+        o->overlaps_cells = for_each_cell_in_area(
+            sb.min, sb.max, [o, &sb](cell& c) {
+                c.add(o, sb.center, sb.radius);
+            });
+    }
+
+    // bounding sphere of the capsule used in the broad phase and the area it
+    // covers
+    struct swept_bounds final {
+        glm::vec3 center{};
+        float radius = 0;
+        glm::vec3 min{};
+        glm::vec3 max{};
+    };
+
+    static auto swept_bounds_of(object const* o) -> swept_bounds {
+        float const dt = frame_context.dt;
+        glm::vec3 const start = o->position();
+        glm::vec3 const end =
+            start + (o->linear_velocity() + o->linear_acceleration() * dt) * dt;
+        float const r = o->bounding_radius();
+
+        return {.center = (start + end) * 0.5f,
+                .radius = r + glm::length(end - start) * 0.5f,
+                .min = glm::min(start, end) - r,
+                .max = glm::max(start, end) + r};
+    }
+
+    // called from 'add_parallel' by a worker
+    // note: same as 'add' but the entries are added to the bin
+    auto fill_bin(bin& b) -> void {
+        b.entries.clear();
+        b.counts.fill(0);
+        for (object** it = b.begin; it < b.end; ++it) {
+            object* o = *it;
+            if (o->is_static()) {
+                continue;
+            }
+            glm::vec3 center = o->position();
+            float radius = o->bounding_radius();
+            glm::vec3 min = center - radius;
+            glm::vec3 max = center + radius;
+            if (o->is_swept) {
+                swept_bounds const sb = swept_bounds_of(o);
+                center = sb.center;
+                radius = sb.radius;
+                min = sb.min;
+                max = sb.max;
+            }
+            uint32_t const sleeping = o->is_sleeping_ ? 1 : 0;
+            o->overlaps_cells = for_each_cell_index_in_area(
+                min, max,
+                [&b, o, &center, radius, sleeping](uint32_t const cell_ix) {
+                    uint32_t const list_ix = cell_ix * 2 + sleeping;
+                    b.entries.push_back({.list_ix = list_ix,
+                                         .radius = radius,
+                                         .object = o,
+                                         .center = center});
+                    ++b.counts[list_ix];
+                });
+        }
+    }
+
+    auto cell_at(uint32_t const cell_ix) -> cell& {
+        return cells[cell_ix / grid_columns][cell_ix % grid_columns];
+    }
+
     // @return true if object overlaps cells
     auto for_each_cell_object_is_in(object* o, auto&& func) -> bool {
+        float const r = o->bounding_radius();
+        glm::vec3 const& p = o->position();
+        return for_each_cell_in_area(p - r, p + r, func);
+    }
+
+    // @return true if area overlaps cells
+    auto for_each_cell_in_area(glm::vec3 const& min, glm::vec3 const& max,
+                               auto&& func) -> bool {
+        return for_each_cell_index_in_area(
+            min, max, [this, &func](uint32_t const cell_ix) {
+                func(cell_at(cell_ix));
+            });
+    }
+
+    // calls 'func(cell_ix)' with 'cell_ix' being 'row * grid_columns + column'
+    // @return true if area overlaps cells
+    static auto for_each_cell_index_in_area(glm::vec3 const& min,
+                                            glm::vec3 const& max, auto&& func)
+        -> bool {
         float constexpr gw = grid_cell_size * grid_columns;
         float constexpr gh = grid_cell_size * grid_rows;
 
-        float const r = o->bounding_radius;
-
         // calculate min max x and z in cell array
-        float const xl = gw / 2 + o->position.x - r;
-        float const xr = gw / 2 + o->position.x + r;
-        float const zt = gh / 2 + o->position.z - r;
-        float const zb = gh / 2 + o->position.z + r;
+        float const xl = gw / 2 + min.x;
+        float const xr = gw / 2 + max.x;
+        float const zt = gh / 2 + min.z;
+        float const zb = gh / 2 + max.z;
 
         uint32_t const xil =
             clamp(int32_t(xl / grid_cell_size), grid_columns - 1);
@@ -178,11 +405,9 @@ class grid final {
         uint32_t const zit = clamp(int32_t(zt / grid_cell_size), grid_rows - 1);
         uint32_t const zib = clamp(int32_t(zb / grid_cell_size), grid_rows - 1);
 
-        // add to cells
         for (uint32_t z = zit; z <= zib; ++z) {
             for (uint32_t x = xil; x <= xir; ++x) {
-                cell& c = cells[z][x];
-                func(c);
+                func(z * grid_columns + x);
             }
         }
 
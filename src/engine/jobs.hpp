@@ -0,0 +1,228 @@
+#pragma once
+
+#include "exception.hpp"
+#include "spinlock.hpp"
+#include <SDL3/SDL_timer.h>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <format>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace glos {
+
+// graph of jobs with declared dependencies that is run as a whole
+// * a job is started when the jobs it depends on are done
+// * jobs without dependency between them may run in parallel on the calling
+//   thread and the worker threads
+// * time spent in each job is measured
+// * when a job throws, the jobs that depend on it, directly or through other
+//   jobs, are cancelled and the exception is re-thrown by 'run'
+// note: a job depends only on jobs added before it
+class jobs final {
+    static uint32_t constexpr max_jobs = 32;
+
+    struct job final {
+        char const* name = nullptr;
+        std::function<void()> func{};
+        uint32_t dependents = 0; // bits of the jobs that depend on this job
+        uint32_t dependencies_count = 0;
+        uint32_t remaining = 0; // dependencies not done in current run
+        float last_ms = 0;      // time of job in previous run
+        double total_ms = 0;
+        uint64_t runs = 0;
+    };
+
+    std::vector<job> jobs_{};
+    std::vector<std::jthread> workers_{};
+    std::mutex mutex_{};
+    std::condition_variable cv_{};
+    // state of current run guarded by 'mutex_'
+    std::vector<uint32_t> ready_{}; // jobs ready to run in order of readiness
+    std::atomic<uint32_t> ready_len_ = 0; // size of 'ready_' read by spinning
+    uint32_t done_ = 0;             // number of jobs done or cancelled
+    uint32_t cancelled_ = 0;        // bits of jobs cancelled
+    std::exception_ptr exception_{};
+    bool is_stopped_ = false;
+    uint32_t spin_us_ = 0; // time workers spin for jobs before waiting
+
+  public:
+    // starts 'threads' worker threads that call 'on_start' then spin
+    // 'spin_us' microseconds for ready jobs before waiting
+    // note: 0 threads to run the jobs on the calling thread only
+    auto init(uint32_t const threads, uint32_t const spin_us,
+              std::function<void()> const& on_start) -> void {
+        spin_us_ = spin_us;
+        for (uint32_t i = 0; i < threads; ++i) {
+            workers_.emplace_back([this, on_start] {
+                on_start();
+                worker_loop();
+            });
+        }
+    }
+
+    auto free() -> void {
+        {
+            std::scoped_lock lock{mutex_};
+            is_stopped_ = true;
+        }
+        cv_.notify_all();
+        workers_.clear();
+    }
+
+    // @return index of job used when declaring the dependencies of later jobs
+    auto add(char const* name,
+             std::initializer_list<uint32_t> const dependencies,
+             std::function<void()> func) -> uint32_t {
+        uint32_t const ix = uint32_t(jobs_.size());
+        if (ix == max_jobs) {
+            throw exception{std::format("jobs: more than {} jobs", max_jobs)};
+        }
+        jobs_.push_back({.name = name,
+                         .func = std::move(func),
+                         .dependencies_count = uint32_t(dependencies.size())});
+        for (uint32_t const dep : dependencies) {
+            jobs_[dep].dependents |= 1u << ix;
+        }
+        return ix;
+    }
+
+    // runs the jobs and returns when all are done
+    // note: exception thrown by a job is re-thrown when all jobs that do not
+    //       depend on it are done
+    auto run() -> void {
+        std::unique_lock lock{mutex_};
+        done_ = 0;
+        cancelled_ = 0;
+        ready_.clear();
+        for (uint32_t i = 0; i < jobs_.size(); ++i) {
+            jobs_[i].remaining = jobs_[i].dependencies_count;
+            if (jobs_[i].remaining == 0) {
+                ready_.push_back(i);
+            }
+        }
+        ready_len_ = uint32_t(ready_.size());
+        cv_.notify_all();
+
+        while (done_ < jobs_.size()) {
+            if (ready_.empty()) {
+                cv_.wait(lock, [this] {
+                    return done_ == jobs_.size() || !ready_.empty();
+                });
+                continue;
+            }
+            run_ready_job(lock);
+        }
+
+        if (exception_) {
+            std::rethrow_exception(std::exchange(exception_, nullptr));
+        }
+    }
+
+    // prints average time of each job
+    auto print_times(FILE* f) const -> void {
+        for (job const& j : jobs_) {
+            double const avg_ms = j.runs ? j.total_ms / double(j.runs) : 0;
+            fprintf(f, "job %-20s: average %7.4f ms  previous %7.4f ms\n",
+                    j.name, avg_ms, double(j.last_ms));
+        }
+    }
+
+  private:
+    auto worker_loop() -> void {
+        std::unique_lock lock{mutex_};
+        while (true) {
+            if (spin_us_ && !is_stopped_ && ready_.empty()) {
+                lock.unlock();
+                spin();
+                lock.lock();
+            }
+            cv_.wait(lock, [this] { return is_stopped_ || !ready_.empty(); });
+            if (is_stopped_) {
+                return;
+            }
+            run_ready_job(lock);
+        }
+    }
+
+    // note: called with 'lock' held which is released while the job runs
+    auto run_ready_job(std::unique_lock<std::mutex>& lock) -> void {
+        uint32_t const ix = ready_.front();
+        ready_.erase(ready_.begin());
+        ready_len_ = uint32_t(ready_.size());
+        job& j = jobs_[ix];
+
+        lock.unlock();
+        uint64_t const t0 = SDL_GetPerformanceCounter();
+        std::exception_ptr ex{};
+        try {
+            j.func();
+        } catch (...) {
+            ex = std::current_exception();
+        }
+        uint64_t const t1 = SDL_GetPerformanceCounter();
+        lock.lock();
+
+        j.last_ms =
+            float(t1 - t0) * 1000 / float(SDL_GetPerformanceFrequency());
+        j.total_ms += double(j.last_ms);
+        ++j.runs;
+        if (ex) {
+            if (!exception_) {
+                exception_ = ex;
+            }
+            cancel_dependents(ix);
+        } else {
+            for (uint32_t i = 0; i < jobs_.size(); ++i) {
+                if ((j.dependents & (1u << i)) && !(cancelled_ & (1u << i)) &&
+                    --jobs_[i].remaining == 0) {
+                    ready_.push_back(i);
+                }
+            }
+        }
+        ready_len_ = uint32_t(ready_.size());
+        ++done_;
+        cv_.notify_all();
+    }
+
+    // cancels the jobs that depend on job 'ix' directly or transitively and
+    // counts them as done
+    // note: called with 'mutex_' held
+    // note: the cancelled jobs cannot be ready or running because they wait
+    //       for job 'ix' which has not released them
+    auto cancel_dependents(uint32_t const ix) -> void {
+        uint32_t cancel = jobs_[ix].dependents;
+        // note: dependents have higher index thus one pass in order of index
+        //       reaches the transitive dependents
+        for (uint32_t i = ix + 1; i < jobs_.size(); ++i) {
+            if (cancel & (1u << i)) {
+                cancel |= jobs_[i].dependents;
+            }
+        }
+        cancel &= ~cancelled_;
+        cancelled_ |= cancel;
+        done_ += uint32_t(std::popcount(cancel));
+    }
+
+    // busy waits at most 'spin_us_' for a job to be ready
+    // note: avoids the latency of waking up between passes of a frame
+    auto spin() const -> void {
+        auto const until = std::chrono::steady_clock::now() +
+                           std::chrono::microseconds(spin_us_);
+        while (ready_len_.load(std::memory_order_relaxed) == 0 &&
+               std::chrono::steady_clock::now() < until) {
+            cpu_pause();
+        }
+    }
+};
+
+} // namespace glos
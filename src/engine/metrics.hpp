@@ -5,7 +5,9 @@
 // reviewed: 2024-01-10
 // reviewed: 2024-07-08
 
+#include "spinlock.hpp"
 #include <SDL3/SDL_timer.h>
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
@@ -31,6 +33,12 @@ class metrics final {
     uint32_t rendered_objects = 0;
     uint32_t rendered_globs = 0;
     uint32_t rendered_triangles = 0;
+    uint32_t culled_pairs = 0; // colliding pairs moving away from each other
+    // note: a pair is counted once per cell both objects overlap
+    uint32_t store_contention = 0; // contended operations on objects store
+    // per lock site when 'spinlock_counters_enabled'
+    std::array<uint32_t, lock_sites_count> lock_acquisitions{};
+    std::array<uint32_t, lock_sites_count> lock_spins{};
     uint64_t update_begin_tick = 0;
     float update_pass_ms = 0;
     uint64_t render_begin_tick = 0;
@@ -52,9 +60,17 @@ class metrics final {
             return;
         }
 
-        fprintf(f, " %7s  %7s  %5s  %7s  %7s  %7s  %6s  %6s  %6s  %9s\n", "ms",
-                "dt_ms", "fps", "drw_ms", "upd_ms", "net_ms", "nobj", "drw_o",
-                "drw_g", "drw_t");
+        fprintf(f,
+                " %7s  %7s  %5s  %7s  %7s  %7s  %6s  %6s  %6s  %9s  %6s  "
+                "%6s",
+                "ms", "dt_ms", "fps", "drw_ms", "upd_ms", "net_ms", "nobj",
+                "drw_o", "drw_g", "drw_t", "cull_p", "str_c");
+        if (spinlock_counters_enabled) {
+            for (char const* name : lock_site_names) {
+                fprintf(f, "  %5s_a  %5s_s", name, name);
+            }
+        }
+        fprintf(f, "\n");
     }
 
     auto print(FILE* f) const -> void {
@@ -64,11 +80,17 @@ class metrics final {
 
         fprintf(f,
                 " %07lu  %7.4f  %05u  %7.4f  %7.4f  %7.4f  %06u  %06u  %06u  "
-                "%09u\n",
+                "%09u  %06u  %06u",
                 ms, double(dt) * 1000, fps.average_during_last_interval,
                 double(render_pass_ms), double(update_pass_ms), double(net_ms),
                 allocated_objects, rendered_objects, rendered_globs,
-                rendered_triangles);
+                rendered_triangles, culled_pairs, store_contention);
+        if (spinlock_counters_enabled) {
+            for (uint32_t i = 0; i < lock_sites_count; ++i) {
+                fprintf(f, "  %07u  %07u", lock_acquisitions[i], lock_spins[i]);
+            }
+        }
+        fprintf(f, "\n");
     }
 
     auto update_begin() -> void {
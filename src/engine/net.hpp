@@ -8,14 +8,19 @@
 #include "../application/configuration.hpp"
 #include "exception.hpp"
 #include "metrics.hpp"
+#include "net_message.hpp"
+#include "net_udp.hpp"
 #include <SDL3/SDL_timer.h>
 #include <arpa/inet.h>
+#include <algorithm>
 #include <array>
 #include <cstdint>
 #include <cstring>
+#include <format>
 #include <netinet/tcp.h>
 #include <sys/socket.h>
 #include <unistd.h>
+#include <vector>
 
 namespace glos {
 
@@ -56,39 +61,7 @@ class net final {
             return;
         }
 
-        fd = socket(AF_INET, SOCK_STREAM, 0);
-        if (fd == -1) {
-            throw exception{strerror(errno)};
-        }
-
-        int flag = 1;
-        if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag))) {
-            throw exception{"cannot set TCP_NODELAY"};
-        }
-
-        struct sockaddr_in server{};
-        server.sin_addr.s_addr = inet_addr(host);
-        server.sin_family = AF_INET;
-        server.sin_port = htons(port);
-
-        printf("[ net ] connecting to '%s' on port %u\n", host, port);
-        if (connect(fd, reinterpret_cast<struct sockaddr*>(&server),
-                    sizeof(server)) < 0) {
-            throw exception{strerror(errno)};
-        }
-
-        printf("[ net ] connected. waiting for go ahead\n");
-        net_init_packet nip{};
-        ssize_t const n = recv(fd, &nip, sizeof(nip), 0);
-        if (n == -1) {
-            throw exception{strerror(errno)};
-        }
-        if (n == 0) {
-            throw exception{"server disconnected"};
-        }
-        if (size_t(n) != sizeof(nip)) {
-            throw exception{"incomplete receive"};
-        }
+        net_init_packet const nip = net_udp ? join_udp() : connect_tcp();
 
         // get server assigned player index and time in milliseconds
         player_ix = nip.player_ix;
@@ -103,6 +76,7 @@ class net final {
             return;
         }
 
+        udp.close();
         if (fd) {
             close(fd);
             fd = 0;
@@ -116,15 +90,10 @@ class net final {
         uint64_t const t0 = SDL_GetPerformanceCounter();
 
         // receive signals from previous frame
-        ssize_t const n = recv(fd, states.data(), sizeof(states), 0);
-        if (n == -1) {
-            throw exception{strerror(errno)};
-        }
-        if (n == 0) {
-            throw exception{"server disconnected"};
-        }
-        if (size_t(n) != sizeof(states)) {
-            throw exception{"incomplete read of states"};
+        if (net_udp) {
+            receive_frame_udp();
+        } else {
+            receive(states.data(), sizeof(states));
         }
 
         // send current frame signals
@@ -142,15 +111,161 @@ class net final {
 
   private:
     int fd = 0;
+    net_message_reader reader{};
+
+    // udp transport
+    net_udp_socket udp{};
+    sockaddr_in server_addr{};
+    std::array<net_state, net_udp_history> inputs{}; // by frame modulo history
+    uint32_t inputs_count = 0; // frame of next input
+    uint32_t inputs_acked = 0; // inputs received by server
+    uint32_t frames_count = 0; // frames received from server
+    std::vector<char> packet{};
+
+    auto connect_tcp() -> net_init_packet {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd == -1) {
+            throw exception{strerror(errno)};
+        }
+
+        int flag = 1;
+        if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag))) {
+            throw exception{"cannot set TCP_NODELAY"};
+        }
+
+        struct sockaddr_in server{};
+        server.sin_addr.s_addr = inet_addr(host);
+        server.sin_family = AF_INET;
+        server.sin_port = htons(port);
 
-    auto send_state() const -> void {
-        ssize_t const n = send(fd, &next_state, sizeof(next_state), 0);
-        if (n == -1) {
+        printf("[ net ] connecting to '%s' on port %u\n", host, port);
+        if (connect(fd, reinterpret_cast<struct sockaddr*>(&server),
+                    sizeof(server)) < 0) {
             throw exception{strerror(errno)};
         }
-        if (size_t(n) != sizeof(next_state)) {
-            throw exception{"incomplete send"};
+
+        printf("[ net ] connected. waiting for go ahead\n");
+        net_init_packet nip{};
+        receive(&nip, sizeof(nip));
+        return nip;
+    }
+
+    // requests to join until server answers with the assigned player
+    auto join_udp() -> net_init_packet {
+        udp.open();
+        packet.resize(sizeof(net_udp_header) +
+                      net_udp_history * sizeof(states));
+        server_addr.sin_addr.s_addr = inet_addr(host);
+        server_addr.sin_family = AF_INET;
+        server_addr.sin_port = htons(port);
+
+        printf("[ net ] joining '%s' on port %u (udp)\n", host, port);
+        while (true) {
+            udp.send(server_addr, {}, nullptr, 0);
+            net_udp_header const* const header = receive_udp();
+            if (header) {
+                return {.player_ix = header->player_ix, .ms = header->ms};
+            }
+        }
+    }
+
+    // receives frame 'frames_count' resending inputs while waiting
+    auto receive_frame_udp() -> void {
+        while (true) {
+            net_udp_header const* const header = receive_udp();
+            if (!header) {
+                // note: the inputs or the frame has been lost
+                send_inputs_udp();
+                continue;
+            }
+            inputs_acked = std::max(inputs_acked, header->ack);
+            if (frames_count < header->first_frame ||
+                frames_count >= header->first_frame + header->count) {
+                // note: frame already received or a duplicate packet
+                continue;
+            }
+            size_t const offset_B =
+                sizeof(net_udp_header) +
+                (frames_count - header->first_frame) * sizeof(states);
+            memcpy(states.data(), packet.data() + offset_B, sizeof(states));
+            ++frames_count;
+            return;
+        }
+    }
+
+    // @return header of received packet in 'packet' or nullptr if timed out
+    auto receive_udp() -> net_udp_header const* {
+        sockaddr_in from{};
+        size_t const size_B =
+            udp.receive(net_udp_resend_ms, from, packet.data(), packet.size());
+        if (size_B == 0 || !net_udp_same_address(from, server_addr)) {
+            return nullptr;
+        }
+        auto const* header =
+            reinterpret_cast<net_udp_header const*>(packet.data());
+        if (size_B < sizeof(net_udp_header) ||
+            header->count > net_udp_history ||
+            size_B != sizeof(net_udp_header) + header->count * sizeof(states)) {
+            throw exception{std::format("invalid packet of {} B", size_B)};
+        }
+        return header;
+    }
+
+    // sends the inputs not acknowledged by server from the last
+    // 'net_udp_history' frames
+    // note: the newest input is always sent
+    auto send_inputs_udp() -> void {
+        uint32_t const first = std::min(
+            std::max(inputs_acked,
+                     inputs_count - std::min(inputs_count, net_udp_history)),
+            inputs_count - 1);
+        std::array<net_state, net_udp_history> entries{};
+        for (uint32_t f = first; f < inputs_count; ++f) {
+            entries[f - first] = inputs[f % net_udp_history];
+        }
+        net_udp_header const header{.ack = frames_count,
+                                    .first_frame = first,
+                                    .count = inputs_count - first};
+        udp.send(server_addr, header, entries.data(),
+                 header.count * sizeof(net_state));
+    }
+
+    auto send_state() -> void {
+        if (net_udp) {
+            inputs[inputs_count % net_udp_history] = next_state;
+            ++inputs_count;
+            send_inputs_udp();
+            return;
+        }
+        std::array<iovec, 1> const parts{{{&next_state, sizeof(next_state)}}};
+        size_t sent_B = 0;
+        check(net_write_message(fd, parts, sent_B));
+    }
+
+    // receives a message with payload of at least 'size_B' bytes
+    // note: blocks until the whole message has been read
+    auto receive(void* const dst, size_t const size_B) -> void {
+        check(reader.read(fd, dst, size_B));
+        if (reader.size_B() < size_B) {
+            throw exception{std::format(
+                "message of {} B is smaller than expected {} B",
+                reader.size_B(), size_B)};
+        }
+    }
+
+    static auto check(net_io const io) -> void {
+        switch (io) {
+        case net_io::complete:
+            return;
+        case net_io::closed:
+            throw exception{"server disconnected"};
+        case net_io::invalid:
+            throw exception{"invalid message header"};
+        case net_io::would_block:
+        case net_io::error:
+            break;
         }
+        throw exception{strerror(errno)};
     }
 } static net{};
 
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "../application/configuration.hpp"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+namespace glos {
+
+// messages on the stream between server and clients are prefixed with a
+// header holding the size of the payload
+// * tcp may split a message over several reads and coalesce several writes
+//   into one read, thus the size tells the reader where a message ends
+// * the payload may have any size up to 'net_message_max_size_B'
+// note: in host byte order as is the payload
+class net_message_header final {
+  public:
+    uint32_t size_B = 0; // of payload following the header
+};
+
+// result of reading or writing a message
+// note: on 'error' errno is set by the failed call
+enum class net_io : uint8_t {
+    complete,    // message has been read or written
+    would_block, // nonblocking socket has no more data or buffer space
+    closed,      // peer closed the connection
+    error,
+    invalid // header with size larger than 'net_message_max_size_B'
+};
+
+// reassembles messages from partial reads of a stream
+// note: works with blocking and nonblocking sockets
+class net_message_reader final {
+    net_message_header header_{};
+    size_t received_B_ = 0; // of header and payload of current message
+
+  public:
+    // reads the available part of a message into 'payload' of 'capacity'
+    // bytes
+    // note: payload bytes beyond 'capacity' are discarded which allows later
+    //       versions of the protocol to append fields to a message
+    // note: when complete the size of the payload is 'size_B()'
+    auto read(int const fd, void* const payload, size_t const capacity)
+        -> net_io {
+        std::array<char, 256> discard{};
+        while (true) {
+            char* dst = nullptr;
+            size_t len = 0;
+            if (received_B_ < sizeof(header_)) {
+                dst = reinterpret_cast<char*>(&header_) + received_B_;
+                len = sizeof(header_) - received_B_;
+            } else {
+                if (header_.size_B > net_message_max_size_B) {
+                    return net_io::invalid;
+                }
+                size_t const done_B = received_B_ - sizeof(header_);
+                if (done_B == header_.size_B) {
+                    received_B_ = 0;
+                    return net_io::complete;
+                }
+                size_t const kept_B =
+                    std::min(size_t(header_.size_B), capacity);
+                if (done_B < kept_B) {
+                    dst = static_cast<char*>(payload) + done_B;
+                    len = kept_B - done_B;
+                } else {
+                    dst = discard.data();
+                    len = std::min(discard.size(), header_.size_B - done_B);
+                }
+            }
+
+            ssize_t const n = recv(fd, dst, len, 0);
+            if (n == -1) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    return net_io::would_block;
+                }
+                if (errno == EINTR) {
+                    continue;
+                }
+                return net_io::error;
+            }
+            if (n == 0) {
+                return net_io::closed;
+            }
+            received_B_ += size_t(n);
+        }
+    }
+
+    // @return size of payload of the message that completed
+    auto size_B() const -> uint32_t { return header_.size_B; }
+};
+
+// writes the rest of a message with payload gathered from 'parts' after
+// 'sent_B' bytes of it have been written
+// * header and payload are written with one call to avoid a small segment
+//   for the header (coalesced write)
+// * 'sent_B' is updated and a partial write is resumed by calling again with
+//   the same 'parts' when the socket is writable
+// note: with a blocking socket the call returns when the message is written
+template <size_t N>
+static auto net_write_message(int const fd, std::array<iovec, N> const& parts,
+                              size_t& sent_B) -> net_io {
+    net_message_header header{};
+    for (iovec const& p : parts) {
+        header.size_B += uint32_t(p.iov_len);
+    }
+    size_t const message_size_B = sizeof(header) + header.size_B;
+
+    while (sent_B < message_size_B) {
+        // gather the part of the message not yet written
+        std::array<iovec, N + 1> iov{};
+        uint32_t iov_len = 0;
+        size_t skip_B = sent_B;
+        auto const gather = [&](void* const base, size_t const len) {
+            if (skip_B >= len) {
+                skip_B -= len;
+                return;
+            }
+            iov[iov_len] = {static_cast<char*>(base) + skip_B, len - skip_B};
+            ++iov_len;
+            skip_B = 0;
+        };
+        gather(&header, sizeof(header));
+        for (iovec const& p : parts) {
+            gather(p.iov_base, p.iov_len);
+        }
+
+        ssize_t const n = writev(fd, iov.data(), int(iov_len));
+        if (n == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return net_io::would_block;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            return net_io::error;
+        }
+        sent_B += size_t(n);
+    }
+    return net_io::complete;
+}
+
+} // namespace glos
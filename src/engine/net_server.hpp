@@ -7,6 +7,13 @@
 
 #include "net.hpp"
 #include <SDL3/SDL.h>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/uio.h>
+#include <vector>
 
 namespace glos {
 
@@ -15,6 +22,11 @@ class net_server final {
     uint16_t port = 8085;
 
     auto init() -> void {
+        if (net_udp) {
+            init_udp();
+            return;
+        }
+
         server_fd = socket(AF_INET, SOCK_STREAM, 0);
         if (server_fd == -1) {
             throw exception{"cannot create socket"};
@@ -46,13 +58,13 @@ class net_server final {
                port);
 
         for (uint32_t i = 1; i < net_players + 1; ++i) {
-            clients_fd[i] = accept(server_fd, nullptr, nullptr);
-            if (clients_fd[i] == -1) {
+            clients[i].fd = accept(server_fd, nullptr, nullptr);
+            if (clients[i].fd == -1) {
                 throw exception{strerror(errno)};
             }
 
             int flag = 1;
-            if (setsockopt(clients_fd[i], IPPROTO_TCP, TCP_NODELAY, &flag,
+            if (setsockopt(clients[i].fd, IPPROTO_TCP, TCP_NODELAY, &flag,
                            sizeof(flag))) {
                 throw exception{strerror(errno)};
             }
@@ -68,38 +80,64 @@ class net_server final {
         for (uint32_t i = 1; i < net_players + 1; ++i) {
             // send initial packet to clients
             nip.player_ix = i;
-            ssize_t const n = send(clients_fd[i], &nip, sizeof(nip), 0);
-            if (n == -1) {
-                throw exception{std::format(
-                    "could not send initial packet to player {}: {}", i,
-                    strerror(errno))};
+            std::array<iovec, 1> const parts{{{&nip, sizeof(nip)}}};
+            size_t sent_B = 0;
+            check(i, net_write_message(clients[i].fd, parts, sent_B));
+        }
+
+        // serve clients with nonblocking sockets as they become ready
+        epoll_fd = epoll_create1(0);
+        if (epoll_fd == -1) {
+            throw exception{strerror(errno)};
+        }
+        for (uint32_t i = 1; i < net_players + 1; ++i) {
+            int const flags = fcntl(clients[i].fd, F_GETFL);
+            if (flags == -1 ||
+                fcntl(clients[i].fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+                throw exception{
+                    std::format("player {}: {}", i, strerror(errno))};
             }
-            if (size_t(n) != sizeof(nip)) {
-                throw exception{std::format("incomplete send to player {}: {}",
-                                            i, strerror(errno))};
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.u32 = i;
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, clients[i].fd, &ev)) {
+                throw exception{
+                    std::format("player {}: {}", i, strerror(errno))};
             }
         }
     }
 
+    // note: clients are served as their sockets become ready thus a slow
+    //       client delays only the frame and not the reads of other clients
     [[noreturn]] auto run() -> void {
+        if (net_udp) {
+            run_udp();
+        }
+
         printf(" * entering loop\n");
         uint64_t t0 = SDL_GetPerformanceCounter();
+        std::array<epoll_event, net_players> events{};
         while (true) {
-            // note: state[0] contains server info sent to all clients
-            //       state[1] etc are the client states
-            for (uint32_t i = 1; i < net_players + 1; ++i) {
-                ssize_t const n =
-                    recv(clients_fd[i], &state[i], sizeof(state[i]), 0);
+            // frame barrier: state of every client received and previous
+            // frame sent to every client
+            while (!is_frame_complete()) {
+                int const n = epoll_wait(epoll_fd, events.data(),
+                                         int(events.size()), -1);
                 if (n == -1) {
-                    throw exception{
-                        std::format("player {}: {}", i, strerror(errno))};
-                }
-                if (n == 0) {
-                    throw exception{std::format("player {}: disconnected", i)};
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw exception{strerror(errno)};
                 }
-                if (size_t(n) != sizeof(state[i])) {
-                    throw exception{
-                        std::format("player {}: read was incomplete", i)};
+                for (int k = 0; k < n; ++k) {
+                    uint32_t const i = events[size_t(k)].data.u32;
+                    uint32_t const ev = events[size_t(k)].events;
+                    if (ev & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+                        receive(i);
+                    }
+                    if (ev & EPOLLOUT) {
+                        send_frame(i);
+                    }
                 }
             }
 
@@ -110,41 +148,321 @@ class net_server final {
             t0 = t1;
 
             // using state[0] to broadcast data from server to all players
-            state[0].look_angle_x = dt;
-            state[0].keys = SDL_GetTicks();
+            net_state& ss = server_state[frame_num & 1];
+            ss.look_angle_x = dt;
+            ss.keys = SDL_GetTicks();
+
+            // note: states received from now on are for next frame
+            ++frame_num;
 
             for (uint32_t i = 1; i < net_players + 1; ++i) {
-                ssize_t const n =
-                    send(clients_fd[i], state.data(), sizeof(state), 0);
-                if (n == -1) {
-                    throw exception{
-                        std::format("player {}: {}", i, strerror(errno))};
-                }
-                if (size_t(n) != sizeof(state)) {
-                    throw exception{
-                        std::format("player {}: send was incomplete", i)};
-                }
+                clients[i].has_state = false;
+                clients[i].sent_B = 0;
+                clients[i].is_sending = true;
+                send_frame(i);
             }
         }
     }
 
     auto free() -> void {
-        size_t const n = clients_fd.size();
-        for (uint32_t i = 1; i < n; i++) {
-            close(clients_fd[i]);
-            clients_fd[i] = 0;
+        if (net_udp) {
+            udp.close();
+            SDL_Quit();
+            return;
+        }
+        for (uint32_t i = 1; i < net_players + 1; i++) {
+            close(clients[i].fd);
+            clients[i].fd = 0;
         }
+        close(epoll_fd);
+        epoll_fd = 0;
         close(server_fd);
         server_fd = 0;
         SDL_Quit();
     }
 
   private:
+    // connection to a player
+    // note: states are double buffered by frame number because a client
+    //       that has received a frame sends its next state while the frame
+    //       is still being sent to other clients
+    struct client final {
+        int fd = 0;
+        std::array<net_state, 2> states{}; // by frame number parity
+        net_message_reader reader{}; // of state of current frame
+        bool has_state = false;      // state of current frame received
+        size_t sent_B = 0;           // of message of previous frame
+        bool is_sending = false;
+        bool is_watching_writable = false;
+    };
+
     int server_fd = 0;
-    std::array<int, net_players + 1> clients_fd{};
-    std::array<net_state, net_players + 1> state{};
-    // note: state[0] is used by server to broadcast to all clients
-    //       delta time for frame (dt) and current server time in ms
+    int epoll_fd = 0;
+    std::array<client, net_players + 1> clients{};
+    // note: index 0 unused to match player index
+    std::array<net_state, 2> server_state{}; // by frame number parity
+    // note: server state is state[0] sent to all clients with delta time for
+    //       frame (dt) and current server time in ms
+    uint64_t frame_num = 0;
+
+    // udp transport
+    // note: 'frame_num' is the frame being collected
+    struct udp_client final {
+        sockaddr_in addr{};
+        net_state input{};         // of frame 'frame_num' when received
+        uint32_t inputs_count = 0; // inputs received
+        uint32_t frames_acked = 0; // frames received by client
+    };
+
+    using frame = std::array<net_state, net_players + 1>;
+
+    net_udp_socket udp{};
+    std::array<udp_client, net_players + 1> udp_clients{};
+    std::array<frame, net_udp_history> frames{}; // by frame modulo history
+    uint64_t start_ms = 0;
+    std::vector<char> packet{};
+
+    // waits for the players to join then sends them the assigned index
+    auto init_udp() -> void {
+        udp.open();
+        udp.bind(port);
+        packet.resize(sizeof(net_udp_header) +
+                      net_udp_history * sizeof(net_state));
+
+        printf(" * waiting for %u players to join on port %u (udp)\n",
+               net_players, port);
+
+        uint32_t joined = 0;
+        while (joined < net_players) {
+            sockaddr_in from{};
+            udp.receive(-1, from, packet.data(), packet.size());
+            if (udp_client_of(from)) {
+                continue;
+            }
+            ++joined;
+            udp_clients[joined].addr = from;
+            printf(" * player %u of %u joined\n", joined, net_players);
+        }
+
+        printf(" * sending start\n");
+
+        start_ms = SDL_GetTicks();
+        for (uint32_t i = 1; i < net_players + 1; ++i) {
+            send_frames_udp(i);
+        }
+    }
+
+    [[noreturn]] auto run_udp() -> void {
+        printf(" * entering loop\n");
+        uint64_t t0 = SDL_GetPerformanceCounter();
+        while (true) {
+            // frame barrier: input of frame received from every client
+            while (!is_frame_complete_udp()) {
+                sockaddr_in from{};
+                size_t const size_B =
+                    udp.receive(-1, from, packet.data(), packet.size());
+                receive_udp(from, size_B);
+            }
+
+            // calculate the delta time for this frame
+            uint64_t const t1 = SDL_GetPerformanceCounter();
+            float const dt =
+                float(t1 - t0) / float(SDL_GetPerformanceFrequency());
+            t0 = t1;
+
+            // using state[0] to broadcast data from server to all players
+            frame& fr = frames[frame_num % net_udp_history];
+            fr[0].look_angle_x = dt;
+            fr[0].keys = SDL_GetTicks();
+            for (uint32_t i = 1; i < net_players + 1; ++i) {
+                fr[i] = udp_clients[i].input;
+            }
+
+            ++frame_num;
+
+            for (uint32_t i = 1; i < net_players + 1; ++i) {
+                send_frames_udp(i);
+            }
+        }
+    }
+
+    auto is_frame_complete_udp() const -> bool {
+        for (uint32_t i = 1; i < net_players + 1; ++i) {
+            if (udp_clients[i].inputs_count <= frame_num) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // handles packet of 'size_B' bytes in 'packet' from address 'from'
+    // note: packets from unknown addresses or that are invalid are dropped
+    auto receive_udp(sockaddr_in const& from, size_t const size_B) -> void {
+        uint32_t const i = udp_client_of(from);
+        auto const* header =
+            reinterpret_cast<net_udp_header const*>(packet.data());
+        if (!i || size_B < sizeof(net_udp_header) ||
+            header->count > net_udp_history ||
+            size_B !=
+                sizeof(net_udp_header) + header->count * sizeof(net_state)) {
+            return;
+        }
+
+        udp_client& c = udp_clients[i];
+        c.frames_acked = std::max(c.frames_acked, header->ack);
+
+        // take the input of the collected frame if not received yet
+        // note: older inputs in the packet are redundant copies
+        uint32_t const f = uint32_t(frame_num);
+        if (c.inputs_count == f && header->first_frame <= f &&
+            f < header->first_frame + header->count) {
+            size_t const offset_B = sizeof(net_udp_header) +
+                                    (f - header->first_frame) *
+                                        sizeof(net_state);
+            memcpy(&c.input, packet.data() + offset_B, sizeof(net_state));
+            ++c.inputs_count;
+        }
+
+        // resend frames the client is missing or the start to a client that
+        // is still joining
+        if (c.frames_acked < frame_num || header->count == 0) {
+            send_frames_udp(i);
+        }
+    }
+
+    // sends to player 'i' the frames not acknowledged from the last
+    // 'net_udp_history' frames
+    auto send_frames_udp(uint32_t const i) -> void {
+        udp_client const& c = udp_clients[i];
+        uint32_t const count = uint32_t(frame_num);
+        uint32_t const first = std::max(
+            c.frames_acked, count - std::min(count, net_udp_history));
+        std::array<frame, net_udp_history> entries{};
+        for (uint32_t f = first; f < count; ++f) {
+            entries[f - first] = frames[f % net_udp_history];
+        }
+        net_udp_header const header{.player_ix = i,
+                                    .ack = c.inputs_count,
+                                    .first_frame = first,
+                                    .count = count - first,
+                                    .ms = start_ms};
+        udp.send(c.addr, header, entries.data(), header.count * sizeof(frame));
+    }
+
+    // @return index of player with address 'addr' or 0 if unknown
+    auto udp_client_of(sockaddr_in const& addr) const -> uint32_t {
+        for (uint32_t i = 1; i < net_players + 1; ++i) {
+            if (net_udp_same_address(udp_clients[i].addr, addr)) {
+                return i;
+            }
+        }
+        return 0;
+    }
+
+    auto is_frame_complete() const -> bool {
+        for (uint32_t i = 1; i < net_players + 1; ++i) {
+            if (!clients[i].has_state || clients[i].is_sending) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // reads the available part of the state of player 'i'
+    auto receive(uint32_t const i) -> void {
+        client& c = clients[i];
+        if (c.has_state) {
+            // note: client sends next state only after receiving the frame
+            //       thus readable socket is a disconnect or an error
+            char byte = 0;
+            ssize_t const n = recv(c.fd, &byte, 1, MSG_PEEK);
+            if (n == -1) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    return;
+                }
+                throw exception{
+                    std::format("player {}: {}", i, strerror(errno))};
+            }
+            if (n == 0) {
+                throw exception{std::format("player {}: disconnected", i)};
+            }
+            throw exception{
+                std::format("player {}: sent state ahead of frame", i)};
+        }
+
+        net_io const io = c.reader.read(c.fd, &c.states[frame_num & 1],
+                                        sizeof(net_state));
+        if (io == net_io::would_block) {
+            return;
+        }
+        check(i, io);
+        if (c.reader.size_B() < sizeof(net_state)) {
+            throw exception{
+                std::format("player {}: message of {} B is smaller than state",
+                            i, c.reader.size_B())};
+        }
+        c.has_state = true;
+    }
+
+    // writes the rest of the frame to player 'i'
+    // note: the frame is one message with payload gathered from the server
+    //       state and the states of the clients with vectored i/o
+    auto send_frame(uint32_t const i) -> void {
+        client& c = clients[i];
+        if (!c.is_sending) {
+            return;
+        }
+
+        // note: the frame being sent is the previous frame
+        uint32_t const buf = (frame_num - 1) & 1;
+        std::array<iovec, net_players + 1> parts{};
+        parts[0] = {&server_state[buf], sizeof(net_state)};
+        for (uint32_t j = 1; j < net_players + 1; ++j) {
+            parts[j] = {&clients[j].states[buf], sizeof(net_state)};
+        }
+
+        net_io const io = net_write_message(c.fd, parts, c.sent_B);
+        if (io == net_io::would_block) {
+            // continue when socket is writable
+            watch_writable(i, true);
+            return;
+        }
+        check(i, io);
+        c.is_sending = false;
+        watch_writable(i, false);
+    }
+
+    // throws if 'io' of player 'i' did not complete
+    static auto check(uint32_t const i, net_io const io) -> void {
+        switch (io) {
+        case net_io::complete:
+            return;
+        case net_io::closed:
+            throw exception{std::format("player {}: disconnected", i)};
+        case net_io::invalid:
+            throw exception{
+                std::format("player {}: invalid message header", i)};
+        case net_io::would_block:
+        case net_io::error:
+            break;
+        }
+        throw exception{std::format("player {}: {}", i, strerror(errno))};
+    }
+
+    // adds or removes waiting for socket of player 'i' to be writable
+    auto watch_writable(uint32_t const i, bool const writable) -> void {
+        client& c = clients[i];
+        if (c.is_watching_writable == writable) {
+            return;
+        }
+        epoll_event ev{};
+        ev.events = writable ? EPOLLIN | EPOLLOUT : EPOLLIN;
+        ev.data.u32 = i;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, c.fd, &ev)) {
+            throw exception{std::format("player {}: {}", i, strerror(errno))};
+        }
+        c.is_watching_writable = writable;
+    }
 } static net_server{};
 
 } // namespace glos
@@ -0,0 +1,195 @@
+#pragma once
+
+#include "../application/configuration.hpp"
+#include "exception.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <poll.h>
+#include <random>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <vector>
+
+namespace glos {
+
+// header of a udp packet followed by 'count' entries
+// * client -> server: entries are the inputs ('net_state') of frames
+//   'first_frame' to 'first_frame + count - 1' and 'ack' is the number of
+//   frames received from server
+// * server -> client: entries are frames of 'net_players + 1' states, 'ack'
+//   is the number of inputs received from the client, 'player_ix' and 'ms'
+//   are the assigned player index and server time at start
+// * a client packet without entries is a request to join
+// note: in host byte order as is the payload
+class net_udp_header final {
+  public:
+    uint32_t player_ix = 0;
+    uint32_t ack = 0;
+    uint32_t first_frame = 0;
+    uint32_t count = 0;
+    uint64_t ms = 0;
+};
+
+// udp socket that simulates packet loss and latency on receive when
+// 'net_udp_shim_loss_percent' or 'net_udp_shim_latency_ms' are set
+// note: simulation is meant for testing on loopback
+class net_udp_socket final {
+    using clock = std::chrono::steady_clock;
+
+    // packet held back by simulated latency
+    struct delayed final {
+        clock::time_point due{};
+        sockaddr_in from{};
+        std::vector<char> data{};
+    };
+
+    static size_t constexpr max_packet_size_B = 64 * 1024;
+
+    int fd_ = -1;
+    std::vector<char> buffer_{};
+    std::deque<delayed> delayed_{};
+    std::minstd_rand random_{};
+
+  public:
+    auto open() -> void {
+        fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd_ == -1) {
+            throw exception{strerror(errno)};
+        }
+        buffer_.resize(max_packet_size_B);
+    }
+
+    auto bind(uint16_t const port) const -> void {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = INADDR_ANY;
+        addr.sin_port = htons(port);
+        if (::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr))) {
+            throw exception{"cannot bind socket"};
+        }
+    }
+
+    auto close() -> void {
+        if (fd_ != -1) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    // sends packet with 'header' followed by 'size_B' bytes of 'entries'
+    // note: header and entries are gathered in one datagram
+    auto send(sockaddr_in const& to, net_udp_header const& header,
+              void const* const entries, size_t const size_B) const -> void {
+        std::array<iovec, 2> iov{{
+            {const_cast<net_udp_header*>(&header), sizeof(header)},
+            {const_cast<void*>(entries), size_B},
+        }};
+        msghdr msg{};
+        msg.msg_name = const_cast<sockaddr_in*>(&to);
+        msg.msg_namelen = sizeof(to);
+        msg.msg_iov = iov.data();
+        msg.msg_iovlen = size_B ? 2 : 1;
+        while (sendmsg(fd_, &msg, 0) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // note: a datagram that cannot be sent is a lost packet
+            if (errno == EAGAIN || errno == EWOULDBLOCK ||
+                errno == ECONNREFUSED || errno == ENOBUFS) {
+                return;
+            }
+            throw exception{strerror(errno)};
+        }
+    }
+
+    // receives a packet into 'dst' of 'capacity' bytes waiting at most
+    // 'timeout_ms' or forever if negative
+    // @return size of the packet or 0 if timed out
+    auto receive(int const timeout_ms, sockaddr_in& from, void* const dst,
+                 size_t const capacity) -> size_t {
+        clock::time_point const until =
+            clock::now() + std::chrono::milliseconds(timeout_ms);
+        while (true) {
+            clock::time_point const now = clock::now();
+            if (!delayed_.empty() && delayed_.front().due <= now) {
+                delayed const& d = delayed_.front();
+                from = d.from;
+                size_t const size_B = d.data.size();
+                memcpy(dst, d.data.data(), std::min(size_B, capacity));
+                delayed_.pop_front();
+                return size_B;
+            }
+            if (timeout_ms >= 0 && now >= until) {
+                return 0;
+            }
+
+            // wait for a packet, the next delayed packet or the timeout
+            int wait_ms = timeout_ms >= 0 ? ms_until(until, now) : -1;
+            if (!delayed_.empty()) {
+                int const due_ms = ms_until(delayed_.front().due, now);
+                wait_ms = wait_ms >= 0 ? std::min(wait_ms, due_ms) : due_ms;
+            }
+            pollfd pfd{.fd = fd_, .events = POLLIN, .revents = 0};
+            int const n = poll(&pfd, 1, wait_ms);
+            if (n == -1 && errno != EINTR) {
+                throw exception{strerror(errno)};
+            }
+            if (n <= 0) {
+                continue;
+            }
+
+            socklen_t from_len = sizeof(from);
+            ssize_t const size = recvfrom(
+                fd_, buffer_.data(), buffer_.size(), MSG_DONTWAIT,
+                reinterpret_cast<sockaddr*>(&from), &from_len);
+            if (size == -1) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK ||
+                    errno == EINTR || errno == ECONNREFUSED) {
+                    continue;
+                }
+                throw exception{strerror(errno)};
+            }
+            auto const size_B = size_t(size);
+
+            if (net_udp_shim_loss_percent &&
+                random_() % 100 < net_udp_shim_loss_percent) {
+                continue;
+            }
+            if (net_udp_shim_latency_ms) {
+                delayed_.push_back(
+                    {.due = now + std::chrono::milliseconds(
+                                      net_udp_shim_latency_ms),
+                     .from = from,
+                     .data = {buffer_.data(), buffer_.data() + size_B}});
+                continue;
+            }
+
+            memcpy(dst, buffer_.data(), std::min(size_B, capacity));
+            return size_B;
+        }
+    }
+
+  private:
+    // @return milliseconds from 'now' to 'time' rounded up
+    static auto ms_until(clock::time_point const time,
+                         clock::time_point const now) -> int {
+        return int(std::max(
+            std::chrono::ceil<std::chrono::milliseconds>(time - now).count(),
+            std::chrono::milliseconds::rep{0}));
+    }
+};
+
+// @return true if 'a' and 'b' are the same address and port
+static auto net_udp_same_address(sockaddr_in const& a, sockaddr_in const& b)
+    -> bool {
+    return a.sin_addr.s_addr == b.sin_addr.s_addr && a.sin_port == b.sin_port;
+}
+
+} // namespace glos
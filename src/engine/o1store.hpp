@@ -3,35 +3,130 @@
 // implements a O(1) store of objects
 //
 // * type: object type. 'type' must contain public field 'type **alloc_ptr'
-// * instance_count: number of preallocated objects
+// * instance_count: number of preallocated objects (in each chunk)
 // * store_id: id used when printing to identify the o1store
 // * return_nullptr_when_no_free_instance_available: if false throws exception
 //   when no free slot available
 // * thread_safe: true to synchronize 'allocate_instance' and 'free_instance'
+//   without locks. each thread takes free instances from and adds freed
+//   instances to a cache that is refilled from and flushed to the shared lists
+//   several instances at a time using atomic operations
 // * instance_size_B: custom size of object instance used to fit largest object
 //   in an object hierarchy. must be multiple of 'cache_line_size_B'
 // * cache_line_size_B: when 'instance_size_B' specified, object store allocated
 //   cache line aligned
+// * max_chunks: if greater than 1 the store is growable. instances are
+//   allocated in chunks of 'instance_count' instances and when no free
+//   instance is available a chunk is allocated up to 'max_chunks' chunks.
+//   instances do not move when the store grows
+//
+// instances may be referenced by 'o1handle' that is validated at 'lookup' and
+// does not alias a different instance allocated in the same slot
 //
 // reviewed: 2024-07-08
 
 #include "../application/configuration.hpp"
 #include "exception.hpp"
+#include "spinlock.hpp"
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <bit>
 #include <cassert>
+#include <cerrno>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <execution>
+#include <memory>
+#include <numeric>
+#include <ranges>
+#include <sys/mman.h>
+#include <vector>
 
 namespace glos {
 
+// index of thread used by thread safe 'o1store' to select cache
+static std::atomic<uint32_t> o1store_threads_count{0};
+static thread_local uint32_t const o1store_thread_ix =
+    o1store_threads_count.fetch_add(1, std::memory_order_relaxed);
+
+// reference to an instance in an 'o1store'
+// * lower bits are the index of the instance and upper bits the generation of
+//   the slot
+// * generation is incremented when the slot is allocated and freed thus it is
+//   odd while the instance is allocated
+// note: default constructed handle is not valid
+struct o1handle final {
+    uint32_t value = 0;
+
+    auto operator==(o1handle const&) const -> bool = default;
+};
+
 template <typename type, size_t instance_count, uint32_t store_id = 0,
           bool return_nullptr_when_no_free_instance_available = false,
           bool thread_safe = false, size_t instance_size_B = 0,
-          size_t cache_line_size_B = 0>
+          size_t cache_line_size_B = 0, size_t max_chunks = 1>
 class o1store final {
-    type* all_ = nullptr;
+    // free instances taken from the free list and freed instances not yet
+    // added to the delete list by a thread
+    // note: other threads may take entries of 'free' when the store is out of
+    //       instances thus an entry is claimed by exchanging it with nullptr
+    //       and entries not holding an instance are nullptr
+    struct alignas(::cache_line_size_B) thread_cache final {
+        type* free[o1store_thread_cache_size]{};
+        type* freed[o1store_thread_cache_size]{};
+        uint32_t free_len = 0; // used by owning thread, entries above are null
+        uint32_t freed_len = 0;
+    };
+
+    // number of instances taken by a refill of a thread cache
+    // note: a fraction of a chunk thus a few threads cannot hold all free
+    //       instances of a size class with few instances per chunk
+    static uint32_t constexpr thread_cache_refill_count = uint32_t(std::clamp(
+        instance_count / o1store_thread_cache_chunk_divisor, size_t{1},
+        size_t{o1store_thread_cache_size}));
+
+    // number of instances when all chunks are allocated
+    static size_t constexpr capacity_ = instance_count * max_chunks;
+
+    // size of instance including padding and size of chunk in bytes
+    static size_t constexpr stride_B = instance_size_B ? instance_size_B
+                                                       : sizeof(type);
+    static size_t constexpr chunk_size_B = instance_count * stride_B;
+
+    // chunks of instances with custom size are mapped when 'o1store_mmap'
+    static bool constexpr is_mapped = o1store_mmap && instance_size_B != 0;
+
+    // chunks smaller than a huge page are not worth a huge page
+    static bool constexpr is_huge_paged =
+        is_mapped && o1store_huge_pages &&
+        chunk_size_B >= o1store_huge_page_size_B;
+
+    // alignment and size of mapped chunk
+    static size_t constexpr page_size_B = 4096;
+    static size_t constexpr map_alignment_B =
+        is_huge_paged ? o1store_huge_page_size_B : page_size_B;
+    static size_t constexpr mapped_chunk_size_B =
+        (chunk_size_B + map_alignment_B - 1) / map_alignment_B *
+        map_alignment_B;
+
+    // bits of handle used by index of instance and the rest by generation
+    static uint32_t constexpr handle_index_bits =
+        uint32_t(std::bit_width(capacity_ - 1));
+    static_assert(handle_index_bits <= 24);
+    static uint32_t constexpr handle_index_mask =
+        uint32_t((uint64_t{1} << handle_index_bits) - 1);
+
+    std::array<type*, max_chunks> chunks_{};
+    std::atomic<uint32_t> chunks_len_{0};
+    // number of instances in chunks that have been taken at least once
+    // note: instances that have not been used are taken in order from the
+    //       chunks and freed instances are reused from the free list
+    uint32_t fresh_len_ = 0;
+    spinlock<lock_site::o1store_grow> grow_lock_{};
+    uint32_t high_water_mark_ = 0; // maximum number of allocated instances
     type** free_bgn_ = nullptr;
     type** free_ptr_ = nullptr;
     type** free_end_ = nullptr;
@@ -40,94 +135,142 @@ class o1store final {
     type** del_bgn_ = nullptr;
     type** del_ptr_ = nullptr;
     type** del_end_ = nullptr;
-    std::atomic_flag lock = ATOMIC_FLAG_INIT;
+    uint32_t* generations_ = nullptr; // generation of each slot
+    // state of each slot in two bitmaps
+    // * free: no bit set
+    // * allocated: bit set in 'allocated_bits_'
+    // * pending free: bit set in both bitmaps until 'apply_free()'
+    static size_t constexpr bitmap_words = (capacity_ + 63) / 64;
+    uint64_t* allocated_bits_ = nullptr;
+    uint64_t* pending_free_bits_ = nullptr;
+    thread_cache* thread_caches_ = nullptr; // used when 'thread_safe'
+    // failed attempts to update shared lists due to other threads
+    std::atomic<uint32_t> contention_{0};
 
   public:
     o1store() {
         if (instance_size_B) {
             static_assert(instance_size_B % cache_line_size_B == 0);
-            // allocate cache line aligned memory
-            size_t constexpr mem_size = instance_count * instance_size_B;
-            void* const mem = std::aligned_alloc(cache_line_size_B, mem_size);
-            assert(mem);
-            assert((uintptr_t(mem) % cache_line_size_B) == 0);
-            std::memset(mem, 0, mem_size);
-            all_ = static_cast<type*>(mem);
-        } else {
-            all_ =
-                static_cast<type*>(std::calloc(instance_count, sizeof(type)));
-            assert(all_);
         }
 
-        free_ptr_ = free_bgn_ =
-            static_cast<type**>(std::calloc(instance_count, sizeof(type*)));
-        assert(free_ptr_);
+        free_bgn_ = static_cast<type**>(std::calloc(capacity_, sizeof(type*)));
+        assert(free_bgn_);
 
         alloc_ptr_ = alloc_bgn_ =
-            static_cast<type**>(std::calloc(instance_count, sizeof(type*)));
+            static_cast<type**>(std::calloc(capacity_, sizeof(type*)));
         assert(alloc_ptr_);
 
         del_ptr_ = del_bgn_ =
-            static_cast<type**>(std::calloc(instance_count, sizeof(type*)));
+            static_cast<type**>(std::calloc(capacity_, sizeof(type*)));
         assert(del_ptr_);
 
-        free_end_ = free_bgn_ + instance_count;
-        del_end_ = del_bgn_ + instance_count;
+        free_ptr_ = free_end_ = free_bgn_ + capacity_;
+        del_end_ = del_bgn_ + capacity_;
 
-        // write pointers to instances in the 'free' list
-        type* all_it = all_;
-        for (type** free_it = free_bgn_; free_it < free_end_; ++free_it) {
-            *free_it = all_it;
-            if (instance_size_B) {
-                all_it = reinterpret_cast<type*>(
-                    reinterpret_cast<char*>(all_it) + instance_size_B);
-            } else {
-                ++all_it;
-            }
+        generations_ =
+            static_cast<uint32_t*>(std::calloc(capacity_, sizeof(uint32_t)));
+        assert(generations_);
+
+        allocated_bits_ =
+            static_cast<uint64_t*>(std::calloc(bitmap_words, sizeof(uint64_t)));
+        assert(allocated_bits_);
+
+        pending_free_bits_ =
+            static_cast<uint64_t*>(std::calloc(bitmap_words, sizeof(uint64_t)));
+        assert(pending_free_bits_);
+
+        if (thread_safe) {
+            size_t constexpr caches_size =
+                o1store_thread_caches * sizeof(thread_cache);
+            void* const mem =
+                std::aligned_alloc(alignof(thread_cache), caches_size);
+            assert(mem);
+            thread_caches_ = static_cast<thread_cache*>(mem);
+            std::uninitialized_default_construct_n(thread_caches_,
+                                                   o1store_thread_caches);
         }
+
+        add_chunk();
     }
 
     ~o1store() {
-        std::free(all_);
+        for (uint32_t i = 0; i < chunks_len_; ++i) {
+            if (is_mapped) {
+                munmap(chunks_[i], mapped_chunk_size_B);
+            } else {
+                std::free(chunks_[i]);
+            }
+        }
         std::free(alloc_bgn_);
         std::free(free_bgn_);
         std::free(del_bgn_);
+        std::free(generations_);
+        std::free(allocated_bits_);
+        std::free(pending_free_bits_);
+        std::free(thread_caches_);
     }
 
     // allocates an instance
     // @return nullptr or throws if instance could not be allocated
     auto allocate_instance() -> type* {
+        type* inst = nullptr;
         if (thread_safe) {
-            acquire_lock();
+            inst = take_free_instance_from_thread_cache();
+        } else if (free_ptr_ < free_end_) {
+            inst = *free_ptr_;
+            ++free_ptr_;
+        } else {
+            take_fresh_instances_or_grow(&inst, 1);
         }
-        if (free_ptr_ >= free_end_) {
-            if (thread_safe) {
-                release_lock();
-            }
+        if (!inst) {
             if (return_nullptr_when_no_free_instance_available) {
                 return nullptr;
             } else {
                 throw exception{std::format(
                     "store {}: out of free instances. consider increasing "
-                    "the size of the store.",
+                    "the size or the maximum number of chunks of the store.",
                     store_id)};
             }
         }
-        type* inst = *free_ptr_;
-        ++free_ptr_;
-        *alloc_ptr_ = inst;
-        inst->alloc_ptr = alloc_ptr_;
-        ++alloc_ptr_;
+        uint32_t const ix = index_of(inst);
+        increment_generation(ix);
+        set_bit(allocated_bits_, ix);
+        type** alloc_it = nullptr;
         if (thread_safe) {
-            release_lock();
+            alloc_it = std::atomic_ref{alloc_ptr_}.fetch_add(
+                1, std::memory_order_relaxed);
+        } else {
+            alloc_it = alloc_ptr_;
+            ++alloc_ptr_;
         }
+        *alloc_it = inst;
+        inst->alloc_ptr = alloc_it;
         return inst;
     }
 
     // adds instance to list of instances to be freed with 'apply_free()'
     auto free_instance(type* const inst) -> void {
+        uint32_t const ix = index_of(inst);
+        if (o1store_check_double_free) {
+            if (ix >= capacity_) {
+                throw exception{std::format(
+                    "store {}: free of instance not in store", store_id)};
+            }
+        }
+        bool const was_pending_free = set_bit(pending_free_bits_, ix);
+        if (o1store_check_double_free) {
+            if (was_pending_free) {
+                throw exception{std::format("store {}: double free", store_id)};
+            }
+            if (!is_bit_set(allocated_bits_, ix)) {
+                throw exception{std::format(
+                    "store {}: free of instance not allocated", store_id)};
+            }
+        }
+
         if (thread_safe) {
-            acquire_lock();
+            add_freed_instance_to_thread_cache(inst);
+            return;
         }
 
         if (o1store_check_free_limits) {
@@ -137,26 +280,20 @@ class o1store final {
             }
         }
 
-        if (o1store_check_double_free) {
-            for (type** it = del_bgn_; it < del_ptr_; ++it) {
-                if (*it == inst) {
-                    throw exception{
-                        std::format("store {}: double free", store_id)};
-                }
-            }
-        }
-
         *del_ptr_ = inst;
         ++del_ptr_;
-
-        if (thread_safe) {
-            release_lock();
-        }
     }
 
     // deallocates the instances that have been freed and their destructor is
     // called
+    // note: in 'thread_safe' mode must not be called concurrently with
+    //       'allocate_instance' or 'free_instance'
     auto apply_free(auto&& callback) -> void {
+        if (thread_safe) {
+            flush_thread_caches();
+        }
+        // note: all instances allocated since previous call are in the list
+        high_water_mark_ = std::max(high_water_mark_, allocated_list_len());
         for (type** it = del_bgn_; it < del_ptr_; ++it) {
             type* inst_deleted = *it;
             callback(inst_deleted);
@@ -166,11 +303,69 @@ class o1store final {
             *(inst_deleted->alloc_ptr) = inst_to_move;
             free_ptr_--;
             *free_ptr_ = inst_deleted;
+            uint32_t const ix = index_of(inst_deleted);
+            increment_generation(ix);
+            clear_bit(allocated_bits_, ix);
+            clear_bit(pending_free_bits_, ix);
             inst_deleted->~type();
         }
         del_ptr_ = del_bgn_;
     }
 
+    // @return true if instance is allocated and not freed
+    // note: used to check use after free
+    auto is_allocated(type const* const inst) const -> bool {
+        uint32_t const ix = index_of(inst);
+        return ix < capacity_ && is_bit_set(allocated_bits_, ix) &&
+               !is_bit_set(pending_free_bits_, ix);
+    }
+
+    // calls 'func(type*)' on allocated instances, including instances pending
+    // free
+    // note: the words of the bitmap are visited with execution 'policy' thus
+    //       with a sequenced policy in order of index and with a parallel
+    //       policy 'func' is called concurrently
+    // note: must not be called concurrently with 'allocate_instance' or
+    //       'apply_free'
+    auto for_each_allocated(auto const& policy, auto&& func) const -> void {
+        auto const words = std::views::iota(size_t{0}, bitmap_words);
+        std::for_each(policy, words.begin(), words.end(),
+                      [this, &func](size_t const w) {
+                          uint64_t bits = allocated_bits_[w];
+                          while (bits) {
+                              size_t const bit = size_t(std::countr_zero(bits));
+                              func(instance(w * 64 + bit));
+                              bits &= bits - 1;
+                          }
+                      });
+    }
+
+    // @return handle of allocated instance
+    auto handle_of(type const* const inst) const -> o1handle {
+        uint32_t const ix = index_of(inst);
+        return {(generation(ix) << handle_index_bits) | ix};
+    }
+
+    // @return instance referenced by 'handle' or nullptr if the instance has
+    //         been freed or the handle is not valid
+    auto lookup(o1handle const handle) const -> type* {
+        uint32_t const ix = handle.value & handle_index_mask;
+        if (ix >= capacity_) {
+            return nullptr;
+        }
+        uint32_t const gen = generation(ix) & (~0u >> handle_index_bits);
+        if ((handle.value >> handle_index_bits) != gen || !(gen & 1)) {
+            return nullptr;
+        }
+        return instance(ix);
+    }
+
+    // @return number of failed attempts to update the shared lists due to
+    //         other threads since previous call
+    auto take_contention_count() -> uint32_t {
+        return contention_.exchange(0, std::memory_order_relaxed);
+    }
+
     // @return list of allocated instances
     auto allocated_list() const -> type** { return alloc_bgn_; }
 
@@ -182,36 +377,368 @@ class o1store final {
     // @return one past the end of allocated instances list
     auto allocated_list_end() const -> type** { return alloc_ptr_; }
 
-    // @return the list with all preallocated instances
-    auto all_list() const -> type* { return all_; }
+    // @return number of instances when all chunks are allocated
+    auto constexpr capacity() const -> size_t { return capacity_; }
 
-    // @return the length of 'all' list
-    auto constexpr all_list_len() const -> size_t { return instance_count; }
+    // @return number of allocated chunks
+    auto chunks_count() const -> uint32_t {
+        return chunks_len_.load(std::memory_order_acquire);
+    }
+
+    // @return maximum number of allocated instances at 'apply_free()'
+    auto high_water_mark() const -> uint32_t { return high_water_mark_; }
 
-    // @return instance at index 'ix' from 'all' list
+    // @return instance at index 'ix'
     auto instance(size_t const ix) const -> type* {
-        if (!instance_size_B) {
-            return &all_[ix];
-        }
         // note: if instance size is specified do pointer shenanigans
-        return reinterpret_cast<type*>(reinterpret_cast<char*>(all_) +
-                                       instance_size_B * ix);
+        return reinterpret_cast<type*>(
+            reinterpret_cast<char*>(chunks_[ix / instance_count]) +
+            stride_B * (ix % instance_count));
+    }
+
+    // @return generation of slot at index 'ix'
+    // note: atomic because handles may be looked up by other threads while
+    //       the slot is allocated or freed
+    auto generation(uint32_t const ix) const -> uint32_t {
+        return std::atomic_ref{generations_[ix]}.load(
+            std::memory_order_relaxed);
+    }
+
+    // @return index of instance or 'capacity()' if instance is not in store
+    auto index_of(type const* const inst) const -> uint32_t {
+        char const* const ptr = reinterpret_cast<char const*>(inst);
+        uint32_t const chunks_len = chunks_count();
+        for (uint32_t i = 0; i < chunks_len; ++i) {
+            char const* const bgn = reinterpret_cast<char const*>(chunks_[i]);
+            if (ptr >= bgn && ptr < bgn + chunk_size_B) {
+                return uint32_t(i * instance_count +
+                                size_t(ptr - bgn) / stride_B);
+            }
+        }
+        return uint32_t(capacity_);
     }
 
     // @return the size of allocated heap memory in bytes
-    auto constexpr allocated_data_size_B() const -> size_t {
-        return instance_size_B ? (instance_count * instance_size_B +
-                                  3 * instance_count * sizeof(type*))
-                               : (instance_count * sizeof(type) +
-                                  3 * instance_count * sizeof(type*));
+    auto allocated_data_size_B() const -> size_t {
+        return chunks_count() *
+                   (is_mapped ? mapped_chunk_size_B : chunk_size_B) +
+               3 * capacity_ * sizeof(type*) + capacity_ * sizeof(uint32_t);
+    }
+
+  private:
+    // allocates a chunk of fresh instances
+    // @return false if maximum number of chunks have been allocated
+    // note: in 'thread_safe' mode called with 'grow_lock_' held
+    auto add_chunk() -> bool {
+        uint32_t const chunk_ix = chunks_len_.load(std::memory_order_relaxed);
+        if (chunk_ix == max_chunks) {
+            return false;
+        }
+
+        type* chunk = nullptr;
+        if (is_mapped) {
+            chunk = static_cast<type*>(map_chunk());
+        } else if (instance_size_B) {
+            // allocate cache line aligned memory
+            void* const mem =
+                std::aligned_alloc(cache_line_size_B, chunk_size_B);
+            assert(mem);
+            assert((uintptr_t(mem) % cache_line_size_B) == 0);
+            std::memset(mem, 0, chunk_size_B);
+            chunk = static_cast<type*>(mem);
+        } else {
+            chunk =
+                static_cast<type*>(std::calloc(instance_count, sizeof(type)));
+            assert(chunk);
+        }
+        chunks_[chunk_ix] = chunk;
+        // note: chunk is visible to thread that sees the new length
+        chunks_len_.store(chunk_ix + 1, std::memory_order_release);
+        return true;
+    }
+
+    // @return zero filled memory for a chunk aligned to 'map_alignment_B'
+    // note: pages are not backed by memory until first touched
+    static auto map_chunk() -> void* {
+        // map extra memory to be able to align and unmap the excess
+        size_t constexpr map_size_B = mapped_chunk_size_B + map_alignment_B;
+        void* const mem = mmap(nullptr, map_size_B, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) {
+            throw exception{std::format("store {}: cannot map {} B: {}",
+                                        store_id, map_size_B,
+                                        std::strerror(errno))};
+        }
+        char* const bgn = static_cast<char*>(mem);
+        char* const aligned = reinterpret_cast<char*>(
+            (uintptr_t(bgn) + map_alignment_B - 1) / map_alignment_B *
+            map_alignment_B);
+        char* const end = bgn + map_size_B;
+        char* const aligned_end = aligned + mapped_chunk_size_B;
+        if (aligned != bgn) {
+            munmap(bgn, size_t(aligned - bgn));
+        }
+        if (aligned_end != end) {
+            munmap(aligned_end, size_t(end - aligned_end));
+        }
+
+        if (is_huge_paged) {
+            // note: advice only; ignored if transparent huge pages disabled
+            madvise(aligned, mapped_chunk_size_B, MADV_HUGEPAGE);
+        }
+
+        if (o1store_first_touch) {
+            // note: each page is written by one of the worker threads
+            size_t constexpr pages_count = mapped_chunk_size_B / page_size_B;
+            std::vector<size_t> pages(pages_count);
+            std::iota(pages.begin(), pages.end(), size_t{0});
+            std::for_each(std::execution::par, pages.cbegin(), pages.cend(),
+                          [aligned](size_t const page) {
+                              *reinterpret_cast<char volatile*>(
+                                  aligned + page * page_size_B) = 0;
+                          });
+        }
+
+        return aligned;
+    }
+
+    // takes up to 'count' fresh instances and grows the store when all
+    // allocated chunks have been used
+    // @return number of instances written to 'dst'
+    auto take_fresh_instances_or_grow(type** const dst, uint32_t const count)
+        -> uint32_t {
+        while (true) {
+            uint32_t const n = take_fresh_instances(dst, count);
+            if (n != 0 || !grow()) {
+                return n;
+            }
+        }
+    }
+
+    // @return number of instances written to 'dst'
+    auto take_fresh_instances(type** const dst, uint32_t const count)
+        -> uint32_t {
+        std::atomic_ref const fresh_len{fresh_len_};
+        uint32_t ix = fresh_len.load(std::memory_order_relaxed);
+        uint32_t n = 0;
+        while (true) {
+            uint32_t const available =
+                chunks_count() * uint32_t(instance_count) - ix;
+            n = std::min(count, available);
+            if (n == 0) {
+                return 0;
+            }
+            if (!thread_safe) {
+                fresh_len_ = ix + n;
+                break;
+            }
+            if (fresh_len.compare_exchange_strong(ix, ix + n,
+                                                  std::memory_order_relaxed)) {
+                break;
+            }
+            // note: 'ix' has been updated to the current value
+            contention_.fetch_add(1, std::memory_order_relaxed);
+        }
+        for (uint32_t i = 0; i < n; ++i) {
+            dst[i] = instance(ix + i);
+        }
+        return n;
+    }
+
+    // adds a chunk unless fresh instances are available
+    // @return false if store cannot grow
+    auto grow() -> bool {
+        if (max_chunks == 1) {
+            return false;
+        }
+        if (thread_safe) {
+            grow_lock_.lock();
+        }
+        // note: a different thread might have added a chunk
+        bool const has_fresh =
+            std::atomic_ref{fresh_len_}.load(std::memory_order_relaxed) <
+            chunks_count() * uint32_t(instance_count);
+        bool const grown = has_fresh || add_chunk();
+        if (thread_safe) {
+            grow_lock_.unlock();
+        }
+        return grown;
+    }
+
+    auto increment_generation(uint32_t const ix) -> void {
+        std::atomic_ref{generations_[ix]}.store(generation(ix) + 1,
+                                                std::memory_order_relaxed);
+    }
+
+    // @return free instance or nullptr if none available
+    auto take_free_instance_from_thread_cache() -> type* {
+        uint32_t const thread_ix = o1store_thread_ix;
+        if (thread_ix >= o1store_thread_caches) [[unlikely]] {
+            type* inst = nullptr;
+            if (!take_from_free_list(&inst, 1) &&
+                !take_fresh_instances_or_grow(&inst, 1)) {
+                inst = steal_from_thread_caches();
+            }
+            return inst;
+        }
+        thread_cache& tc = thread_caches_[thread_ix];
+        while (tc.free_len) {
+            --tc.free_len;
+            // note: nullptr if taken by another thread
+            type* const inst = std::atomic_ref{tc.free[tc.free_len]}.exchange(
+                nullptr, std::memory_order_acquire);
+            if (inst) {
+                return inst;
+            }
+        }
+
+        std::array<type*, thread_cache_refill_count> refill{};
+        uint32_t n = take_from_free_list(refill.data(), refill.size());
+        if (n == 0) {
+            n = take_fresh_instances_or_grow(refill.data(), refill.size());
+        }
+        if (n == 0) {
+            return steal_from_thread_caches();
+        }
+        // first instance is returned and the rest are cached
+        for (uint32_t i = 1; i < n; ++i) {
+            std::atomic_ref{tc.free[i - 1]}.store(refill[i],
+                                                  std::memory_order_release);
+        }
+        tc.free_len = n - 1;
+        return refill[0];
+    }
+
+    // takes a free instance cached by any thread
+    // @return instance or nullptr if there is none
+    // note: called when the free list and chunks are exhausted while free
+    //       instances might be held by the caches of other threads
+    auto steal_from_thread_caches() -> type* {
+        uint32_t const caches_count =
+            std::min(o1store_threads_count.load(std::memory_order_relaxed),
+                     o1store_thread_caches);
+        for (uint32_t i = 0; i < caches_count; ++i) {
+            thread_cache& tc = thread_caches_[i];
+            for (type*& entry : tc.free) {
+                std::atomic_ref const ref{entry};
+                if (!ref.load(std::memory_order_relaxed)) {
+                    continue;
+                }
+                if (type* const inst =
+                        ref.exchange(nullptr, std::memory_order_acquire)) {
+                    contention_.fetch_add(1, std::memory_order_relaxed);
+                    return inst;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    auto add_freed_instance_to_thread_cache(type* const inst) -> void {
+        uint32_t const thread_ix = o1store_thread_ix;
+        if (thread_ix >= o1store_thread_caches) [[unlikely]] {
+            add_to_delete_list(&inst, 1);
+            return;
+        }
+        thread_cache& tc = thread_caches_[thread_ix];
+        if (tc.freed_len == o1store_thread_cache_size) {
+            add_to_delete_list(tc.freed, tc.freed_len);
+            tc.freed_len = 0;
+        }
+        tc.freed[tc.freed_len] = inst;
+        ++tc.freed_len;
     }
 
-    auto acquire_lock() -> void {
-        while (lock.test_and_set(std::memory_order_acquire)) {
+    // takes up to 'count' instances from the free list
+    // @return number of instances written to 'dst'
+    auto take_from_free_list(type** const dst, uint32_t const count)
+        -> uint32_t {
+        std::atomic_ref const free_ptr{free_ptr_};
+        type** ptr = free_ptr.load(std::memory_order_relaxed);
+        while (true) {
+            uint32_t const n =
+                uint32_t(std::min(ptrdiff_t(count), free_end_ - ptr));
+            if (n == 0) {
+                return 0;
+            }
+            if (free_ptr.compare_exchange_strong(ptr, ptr + n,
+                                                 std::memory_order_relaxed)) {
+                std::copy_n(ptr, n, dst);
+                return n;
+            }
+            // note: 'ptr' has been updated to the current value
+            contention_.fetch_add(1, std::memory_order_relaxed);
         }
     }
 
-    auto release_lock() -> void { lock.clear(std::memory_order_release); }
+    auto add_to_delete_list(type* const* const src, uint32_t const count)
+        -> void {
+        type** const ptr = std::atomic_ref{del_ptr_}.fetch_add(
+            count, std::memory_order_relaxed);
+
+        if (o1store_check_free_limits) {
+            if (ptr + count > del_end_) {
+                throw exception{
+                    std::format("store {}: free overrun", store_id)};
+            }
+        }
+
+        std::copy_n(src, count, ptr);
+    }
+
+    // moves freed instances in thread caches to the delete list and returns
+    // the free instances to the free list
+    // note: called from one thread while no other thread uses the store
+    auto flush_thread_caches() -> void {
+        uint32_t const caches_count =
+            std::min(o1store_threads_count.load(std::memory_order_relaxed),
+                     o1store_thread_caches);
+        for (uint32_t i = 0; i < caches_count; ++i) {
+            thread_cache& tc = thread_caches_[i];
+            add_to_delete_list(tc.freed, tc.freed_len);
+            tc.freed_len = 0;
+            // note: entries taken by other threads are nullptr
+            for (uint32_t j = 0; j < tc.free_len; ++j) {
+                if (tc.free[j]) {
+                    --free_ptr_;
+                    *free_ptr_ = tc.free[j];
+                    tc.free[j] = nullptr;
+                }
+            }
+            tc.free_len = 0;
+        }
+    }
+
+    // sets bit of slot 'ix' in 'bits'
+    // @return previous state of bit
+    // note: atomic in 'thread_safe' mode because bits of different slots
+    //       share a word
+    static auto set_bit(uint64_t* const bits, uint32_t const ix) -> bool {
+        uint64_t const mask = uint64_t{1} << (ix % 64);
+        uint64_t& word = bits[ix / 64];
+        if (thread_safe) {
+            return std::atomic_ref{word}.fetch_or(
+                       mask, std::memory_order_relaxed) &
+                   mask;
+        }
+        bool const was_set = word & mask;
+        word |= mask;
+        return was_set;
+    }
+
+    // note: called from one thread at 'apply_free()' while other threads
+    //       might read the state
+    static auto clear_bit(uint64_t* const bits, uint32_t const ix) -> void {
+        std::atomic_ref const word{bits[ix / 64]};
+        word.store(word.load(std::memory_order_relaxed) &
+                       ~(uint64_t{1} << (ix % 64)),
+                   std::memory_order_relaxed);
+    }
+
+    static auto is_bit_set(uint64_t* const bits, uint32_t const ix) -> bool {
+        return std::atomic_ref{bits[ix / 64]}.load(std::memory_order_relaxed) &
+               (uint64_t{1} << (ix % 64));
+    }
 };
 
 } // namespace glos
@@ -12,61 +12,230 @@
 #include "net.hpp"
 #include "o1store.hpp"
 #include "planes.hpp"
+#include "spinlock.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <execution>
+#include <format>
 #include <glm/gtc/quaternion.hpp>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 namespace glos {
 
+// hot state of objects in cache line aligned parallel arrays indexed by the
+// slot of the object assigned by 'objects'
+// note: per-frame passes read the arrays sequentially instead of jumping
+//       the instance size of the object's size class per object
+class slices final {
+    template <typename type> class array final {
+        static_assert(std::is_trivially_copyable_v<type>);
+
+        type* data_ = nullptr;
+
+      public:
+        // note: value-initialized thus passes over all slots, e.g.
+        //       'objects::integrate_motion', and 'move' at compact read
+        //       defined state also in slots that have not been used
+        array() {
+            size_t constexpr size_B =
+                (objects_count * sizeof(type) + cache_line_size_B - 1) /
+                cache_line_size_B * cache_line_size_B;
+            data_ = static_cast<type*>(
+                std::aligned_alloc(cache_line_size_B, size_B));
+            assert(data_);
+            std::uninitialized_value_construct_n(data_, objects_count);
+        }
+
+        ~array() { std::free(data_); }
+
+        array(array const&) = delete;
+        auto operator=(array const&) -> array& = delete;
+
+        auto operator[](uint32_t const ix) -> type& { return data_[ix]; }
+
+        auto operator[](uint32_t const ix) const -> type const& {
+            return data_[ix];
+        }
+
+        auto data() const -> type* { return data_; }
+    };
+
+  public:
+    // -- grid::add, cell::add
+    array<glm::vec3> position{};       // in meters
+    array<float> bounding_radius{};    // in meters
+    array<uint32_t> collision_bits{};  // mask & bits for collision subscription
+    array<uint32_t> collision_mask{};  // ...
+    // -- objects::update
+    array<glm::vec3> linear_acceleration{}; // in meters/second^2
+    array<glm::vec3> linear_velocity{};     // in meters/second
+    array<glm::quat> orientation{};         // dimensionless
+    array<glm::vec3> angular_velocity{};    // in radians/second
+    // -- cell::resolve_collisions, solver
+    array<float> mass{};     // in kg
+    array<float> inv_mass{}; // 1 / mass or 0 if static
+    // -- objects::update_Mmw_matrices
+    array<glm::vec3> scale{}; // in meters
+    // -- objects::integrate_motion
+    array<uint8_t> is_integrated{}; // 1 if motion is integrated by engine
+    // state at previous simulation tick
+    array<glm::vec3> previous_position{};
+    array<glm::quat> previous_orientation{};
+    // -- cell: swept objects
+    array<float> time_of_impact{}; // fraction of frame at earliest impact
+
+    // sets state at 'slot' to the state of a new object
+    auto init(uint32_t const slot) -> void {
+        position[slot] = {};
+        bounding_radius[slot] = 0;
+        collision_bits[slot] = 0;
+        collision_mask[slot] = 0;
+        linear_acceleration[slot] = {};
+        linear_velocity[slot] = {};
+        orientation[slot] = {};
+        angular_velocity[slot] = {};
+        mass[slot] = 0;
+        inv_mass[slot] = 0;
+        scale[slot] = {};
+        is_integrated[slot] = 0;
+        previous_position[slot] = {};
+        previous_orientation[slot] = {};
+        time_of_impact[slot] = 1;
+    }
+
+    // moves state at slots 'from[i]' to slots 'to[i]'
+    // note: 'to' is a permutation of 'from'
+    auto move(std::vector<uint32_t> const& from,
+              std::vector<uint32_t> const& to) -> void {
+        auto const move_array = [&from, &to](auto& arr) {
+            using type = std::remove_cvref_t<decltype(arr[0])>;
+            std::vector<type> state(from.size());
+            for (size_t i = 0; i < from.size(); ++i) {
+                state[i] = arr[from[i]];
+            }
+            for (size_t i = 0; i < to.size(); ++i) {
+                arr[to[i]] = state[i];
+            }
+        };
+        move_array(position);
+        move_array(bounding_radius);
+        move_array(collision_bits);
+        move_array(collision_mask);
+        move_array(linear_acceleration);
+        move_array(linear_velocity);
+        move_array(orientation);
+        move_array(angular_velocity);
+        move_array(mass);
+        move_array(inv_mass);
+        move_array(scale);
+        move_array(is_integrated);
+        move_array(previous_position);
+        move_array(previous_orientation);
+        move_array(time_of_impact);
+    }
+
+    // lowers time of impact at 'slot' to 't' if 't' is earlier
+    // note: called concurrently by cells that share a swept object
+    auto lower_time_of_impact(uint32_t const slot, float const t) -> void {
+        std::atomic_ref<float> const toi{time_of_impact[slot]};
+        float current = toi.load(std::memory_order_relaxed);
+        while (t < current &&
+               !toi.compare_exchange_weak(current, t,
+                                          std::memory_order_relaxed)) {
+        }
+    }
+
+    // integrates velocity, position and orientation at 'slot' during 'dt'
+    auto integrate(uint32_t const slot, float const dt) -> void {
+        linear_velocity[slot] += linear_acceleration[slot] * dt;
+        position[slot] += linear_velocity[slot] * dt;
+
+        glm::vec3 const& w = angular_velocity[slot];
+        glm::quat const omega_q = {0.0f, w.x, w.y, w.z};
+        glm::quat const dq = (omega_q * orientation[slot]) * 0.5f;
+        orientation[slot] = glm::normalize(orientation[slot] + (dq * dt));
+    }
+} static slices{};
+
+class object;
+
+// @return index of object in 'objects' store
+// note: defined after 'objects'
+static auto object_index(object const* o) -> uint32_t;
+
+// @return slot in 'slices' of object at 'index' in 'objects' store
+// note: defined after 'objects'
+static auto object_slot(uint32_t index) -> uint32_t;
+
+// @return handle of object in 'objects' store
+// note: defined after 'objects'
+static auto object_handle(object const* o) -> o1handle;
+
 class object {
     friend class grid;
     friend class cell;
+    friend class objects;
+    friend class solver;
+
+    // render thread reads a copy of the matrix when it runs in parallel with
+    // update thread
+    static bool constexpr is_rendered_Mmw_buffered =
+        threaded_update && !threaded_update_pipelined;
 
     // members in order they are accessed by 'grid::add', 'cell::add',
-    // 'cell::update', 'cell:resolve_collisions', 'cell::render' with cache
+    // 'objects::update', 'cell:resolve_collisions', 'cell::render' with cache
     // coherence in mind
-  public:
+  private:
     // -- grid::add, cell::add
-    glm::vec3 position{};        // in meters
-    float bounding_radius = 0;   // in meters
-    uint32_t collision_bits = 0; // mask & bits for collision subscription
-    uint32_t collision_mask = 0; // ...
+    uint32_t slot_ = 0; // index of hot state in 'slices'
+  public:
+    bool is_swept = false; // continuous collision detection for fast objects
   private:
     bool overlaps_cells = false; // used by grid to flag cell overlap
     bool is_static_ = false;     // immovable object
-    // -- cell::update
-    std::atomic_flag lock = ATOMIC_FLAG_INIT;
-    uint32_t updated_at_tick = 0; // used by cell to avoid updating twice
+    // -- objects::update
+    spinlock<lock_site::object> lock{};
+    uint32_t type_ix_ = 0;      // index of concrete type in 'objects' registry
+    uint32_t type_list_ix_ = 0; // index in list of objects of the type
+    uint32_t index_ = 0;        // index of instance in 'objects' store
+    uint32_t rest_frames = 0;     // consecutive frames at rest
+    bool is_sleeping_ = false;    // resting object not updated until woken
+    bool default_motion_ = true;  // motion is integrated by engine
+    bool is_allocation_applied_ = false; // object is part of the simulation
   public:
-    glm::vec3 linear_acceleration{}; // in meters/second^2
-    glm::vec3 linear_velocity{};     // in meters/second
-    glm::quat orientation{};         // dimensionless
-    glm::vec3 angular_velocity{};    // in radians/second
+    bool can_sleep = true; // false if object must be updated every frame
   private:
-    std::vector<object const*> handled_collisions{};
+    std::vector<o1handle> handled_collisions{};
     bool is_dead = false; // used by 'cell' to avoid events to dead objects
+    uint64_t solver_colors = 0; // used by 'solver' when coloring contacts
   public:
     // -- cell::resolve_collisions: spheres
     bool is_sphere = false; // true if object can be considered a sphere
   private:
-    float mass_ = 0; // in kg
     // -- cell::resolve_collisions: planes
-    planes planes{}; // bounding planes (if any)
-    std::atomic_flag lock_Mmw = ATOMIC_FLAG_INIT;
+    planes planes{};     // bounding planes (if any)
     glm::vec3 Mmw_pos{}; // position of current Mmw matrix
     glm::quat Mmw_ori{}; // orientation of current Mmw matrix
     glm::vec3 Mmw_scl{}; // scale of current Mmw matrix
-  public:
-    glm::vec3 scale{}; // in meters
-  private:
-    glm::mat4 Mmw{}; // model -> world matrix
+    glm::mat4 Mmw{};     // model -> world matrix
   public:
     glm::mat3 invIm{}; // model inverted inertia tensor
   private:
     glm::mat3 invIw{}; // world inverted inertia tensor
-    float invMass = 0;
-    std::atomic_flag lock_invIw = ATOMIC_FLAG_INIT;
+    spinlock<lock_site::object_invIw> lock_invIw{};
     glm::quat invIw_ori{}; // current world inverted inertia tensor orientation
     // -- cell::render
     uint32_t rendered_at_tick = 0; // used by 'cell' to avoid rendering twice
+    glm::mat4 rendered_Mmw_{};     // buffered when 'threaded_update'
     uint32_t glob_ix_ = 0;         // index in globs store
   public:
     // -- other
@@ -75,17 +244,23 @@ class object {
     std::string name{};             // instance name
     object** alloc_ptr;             // initiated at allocate by 'o1store'
 
-    // note: 32 bit resolution of 'updated_at_tick' and 'rendered_at_tick' vs 64
-    //       bit comparison source ok since only checking for equality
+    // note: 32 bit resolution of 'rendered_at_tick' vs 64 bit comparison
+    //       source ok since only checking for equality
 
   public:
-    virtual ~object() = default;
+    object() {
+        index_ = object_index(this);
+        slot_ = object_slot(index_);
+        slices.init(slot_);
+    }
+
+    virtual ~object() { slices.is_integrated[slot_] = 0; }
     // note: 'delete obj;' may not be used because memory is managed by
     //       'o1store'. destructor is invoked at 'objects.apply_free(...)'
 
     // called from 'cell'
     virtual auto render() -> void {
-        glob().render(updated_Mmw());
+        glob().render(rendered_Mmw());
 
         if (is_debug_object_planes_normals) {
             planes.debug_render_normals();
@@ -96,25 +271,20 @@ class object {
         }
     }
 
-    // called from 'cell'
+    // called from 'objects' once per frame for objects that are awake
     // @return false if object has died, true otherwise
     // note: only one thread at a time is active in this section
+    // note: statically dispatched for objects allocated with
+    //       'objects.alloc<type>()' thus derived classes should be 'final'
+    // note: motion of objects with 'default_motion()' has been integrated by
+    //       engine before 'update()'
     virtual auto update() -> bool {
-        float const dt = frame_context.dt;
-        linear_velocity += linear_acceleration * dt;
-        position += linear_velocity * dt;
-
-        glm::quat const omega_q = {0.0f, angular_velocity.x, angular_velocity.y,
-                                   angular_velocity.z};
-        glm::quat const dq = (omega_q * orientation) * 0.5f;
-        orientation = glm::normalize(orientation + (dq * dt));
-
         if (is_debug_object_planes_normals) {
             // note: update planes for the normals to be rendered at 'render()'
-            glm::mat4 const& M = updated_Mmw();
+            update_Mmw();
             class glob const& g = glob();
-            planes.update_model_to_world(g.planes_points, g.planes_normals, M,
-                                         position, orientation, scale);
+            planes.update_model_to_world(g.planes_points, g.planes_normals, Mmw,
+                                         Mmw_pos, Mmw_ori, Mmw_scl);
         }
 
         return true;
@@ -127,63 +297,23 @@ class object {
         return true;
     }
 
-    auto updated_Mmw() -> glm::mat4 const& {
-        // * synchronize if render and update run on different threads; both
-        //   racing for this function from 'render()' and 'update()'
-        // * synchronize if 'threaded_grid' because objects in different cells
-        //   running on different threads might race when calling this function
-
-        bool constexpr synchronize = threaded_update || threaded_grid;
-
-        if (synchronize) {
-            while (lock_Mmw.test_and_set(std::memory_order_acquire)) {
-            }
-        }
-
-        if (position == Mmw_pos && orientation == Mmw_ori && scale == Mmw_scl) {
-            if (synchronize) {
-                lock_Mmw.clear(std::memory_order_release);
-            }
-            return Mmw;
-        }
-
-        // save the state of the matrix
-        Mmw_pos = position;
-        Mmw_ori = orientation;
-        Mmw_scl = scale;
-
-        // make a new matrix
-        // todo: insert scale and position without multiplying matrixes
-        glm::mat4 const Ms = glm::scale(glm::mat4(1), Mmw_scl);
-        glm::mat4 const Mr = glm::mat4_cast(Mmw_ori);
-        glm::mat4 const Mt = glm::translate(glm::mat4(1), Mmw_pos);
-        Mmw = Mt * Mr * Ms;
-
-        if (synchronize) {
-            lock_Mmw.clear(std::memory_order_release);
-        }
-
-        return Mmw;
-    }
-
     auto updated_invIw() -> glm::mat3 const& {
 
         bool constexpr synchronize = threaded_grid;
 
         if (synchronize) {
-            while (lock_invIw.test_and_set(std::memory_order_acquire)) {
-            }
+            lock_invIw.lock();
         }
 
-        if (orientation == invIw_ori) {
+        if (orientation() == invIw_ori) {
             if (synchronize) {
-                lock_invIw.clear(std::memory_order_release);
+                lock_invIw.unlock();
             }
             return invIw;
         }
 
         // save the state of the matrix
-        invIw_ori = orientation;
+        invIw_ori = orientation();
 
         // make the inverted world inertia matrix
         // local relation: L_local = I_local * ω_local
@@ -193,12 +323,12 @@ class object {
         // identify: I_world = R I_local R^T
         // therefore: I_world^-1 = R I_local^-1 R^T
 
-        glm::mat3 const rot = glm::mat3_cast(orientation);
+        glm::mat3 const rot = glm::mat3_cast(orientation());
 
         invIw = rot * invIm * glm::transpose(rot);
 
         if (synchronize) {
-            lock_invIw.clear(std::memory_order_release);
+            lock_invIw.unlock();
         }
 
         return invIw;
@@ -215,12 +345,96 @@ class object {
 
     auto glob() const -> glob const& { return globs.at(glob_ix_); }
 
+    // @return model-to-world matrix that is rendered
+    // note: when 'threaded_update' render thread reads the matrix buffered at
+    //       'objects::buffer_rendered_matrices' because the batched pass
+    //       rewrites 'Mmw' while render runs
+    auto rendered_Mmw() const -> glm::mat4 {
+        if (is_rendered_Mmw_buffered) {
+            return rendered_Mmw_;
+        }
+        return current_rendered_Mmw();
+    }
+
+    // @return model-to-world matrix of current state to render
+    auto current_rendered_Mmw() const -> glm::mat4 {
+        return fixed_time_step ? interpolated_Mmw(render_context.alpha) : Mmw;
+    }
+
     auto mass(float const m) -> void {
-        mass_ = m;
-        invMass = m > 0 ? 1 / m : 0;
+        slices.mass[slot_] = m;
+        slices.inv_mass[slot_] = m > 0 ? 1 / m : 0;
+    }
+
+    auto mass() const -> float { return slices.mass[slot_]; }
+
+    // hot state kept in 'slices'
+
+    auto position() -> glm::vec3& { return slices.position[slot_]; }
+
+    auto position() const -> glm::vec3 const& {
+        return slices.position[slot_];
+    }
+
+    auto bounding_radius() -> float& { return slices.bounding_radius[slot_]; }
+
+    auto bounding_radius() const -> float {
+        return slices.bounding_radius[slot_];
+    }
+
+    auto collision_bits() -> uint32_t& { return slices.collision_bits[slot_]; }
+
+    auto collision_bits() const -> uint32_t {
+        return slices.collision_bits[slot_];
+    }
+
+    auto collision_mask() -> uint32_t& { return slices.collision_mask[slot_]; }
+
+    auto collision_mask() const -> uint32_t {
+        return slices.collision_mask[slot_];
+    }
+
+    auto linear_acceleration() -> glm::vec3& {
+        return slices.linear_acceleration[slot_];
+    }
+
+    auto linear_acceleration() const -> glm::vec3 const& {
+        return slices.linear_acceleration[slot_];
+    }
+
+    auto linear_velocity() -> glm::vec3& {
+        return slices.linear_velocity[slot_];
+    }
+
+    auto linear_velocity() const -> glm::vec3 const& {
+        return slices.linear_velocity[slot_];
+    }
+
+    auto orientation() -> glm::quat& { return slices.orientation[slot_]; }
+
+    auto orientation() const -> glm::quat const& {
+        return slices.orientation[slot_];
+    }
+
+    auto angular_velocity() -> glm::vec3& {
+        return slices.angular_velocity[slot_];
     }
 
-    auto mass() const -> float { return mass_; }
+    auto angular_velocity() const -> glm::vec3 const& {
+        return slices.angular_velocity[slot_];
+    }
+
+    auto scale() -> glm::vec3& { return slices.scale[slot_]; }
+
+    auto scale() const -> glm::vec3 const& { return slices.scale[slot_]; }
+
+    auto inv_mass() const -> float { return slices.inv_mass[slot_]; }
+
+    auto slot() const -> uint32_t { return slot_; }
+
+    // @return reference to this object that can be stored and validated with
+    //         'objects.lookup(...)'
+    auto handle() const -> o1handle { return object_handle(this); }
 
     auto is_static(bool const b) {
         is_static_ = b;
@@ -228,21 +442,134 @@ class object {
             mass(0);
             invIm = {};
         }
+        update_is_integrated();
     }
 
     auto is_static() const { return is_static_; }
 
+    auto is_sleeping() const -> bool { return is_sleeping_; }
+
+    // wakes a sleeping object
+    // note: a sleeping object with velocity or acceleration set is woken at
+    //       next update
+    auto wake() -> void {
+        is_sleeping_ = false;
+        rest_frames = 0;
+        update_is_integrated();
+    }
+
+    // false if object integrates its motion in 'update()' e.g. by calling
+    // 'integrate_motion()'
+    auto default_motion(bool const b) -> void {
+        default_motion_ = b;
+        update_is_integrated();
+    }
+
+    auto default_motion() const -> bool { return default_motion_; }
+
+    // integrates velocity, position and orientation during the frame
+    auto integrate_motion() -> void {
+        slices.integrate(slot_, frame_context.dt);
+    }
+
   private:
-    // called from 'cell' in thread safe way
+    // note: velocities are cleared when object falls asleep and an object
+    //       with acceleration does not fall asleep
+    auto has_motion() const -> bool {
+        return linear_velocity() != glm::vec3{} ||
+               angular_velocity() != glm::vec3{} ||
+               linear_acceleration() != glm::vec3{};
+    }
+
+    // called from 'objects' after 'update()'
+    // note: only one thread at a time is active in this section
+    auto update_sleep_state() -> void {
+        if (!sleep_enabled || !can_sleep || is_static_) {
+            return;
+        }
+
+        // note: an accelerated object is not at rest even when its velocity
+        //       is below the threshold because it would be frozen when its
+        //       velocity is cleared
+        bool const is_resting =
+            linear_acceleration() == glm::vec3{} &&
+            glm::dot(linear_velocity(), linear_velocity()) <
+                sleep_linear_velocity * sleep_linear_velocity &&
+            glm::dot(angular_velocity(), angular_velocity()) <
+                sleep_angular_velocity * sleep_angular_velocity;
+
+        if (!is_resting) {
+            rest_frames = 0;
+            return;
+        }
+
+        ++rest_frames;
+
+        if (rest_frames >= sleep_frames) {
+            is_sleeping_ = true;
+            update_is_integrated();
+            linear_velocity() = {};
+            angular_velocity() = {};
+        }
+    }
+
+    // objects in contact form an island that falls asleep and wakes as a whole
+    // * objects in contact share the lowest number of frames at rest thus an
+    //   island falls asleep when all its objects have been resting
+    // * a sleeping object is woken by contact with an object that is not at
+    //   rest and in turn wakes the sleeping objects it is in contact with
+    // note: called with 'o1' and 'o2' synchronized
+    static auto propagate_rest_state(object* o1, object* o2) -> void {
+        if (!sleep_enabled || o1->is_static_ || o2->is_static_) {
+            return;
+        }
+
+        uint32_t const o1_rest_frames = o1->can_sleep ? o1->rest_frames : 0;
+        uint32_t const o2_rest_frames = o2->can_sleep ? o2->rest_frames : 0;
+
+        if (o1->is_sleeping_ || o2->is_sleeping_) {
+            if (o1->is_sleeping_ && !o2->is_sleeping_ && o2_rest_frames == 0) {
+                o1->wake();
+            }
+            if (o2->is_sleeping_ && !o1->is_sleeping_ && o1_rest_frames == 0) {
+                o2->wake();
+            }
+            return;
+        }
+
+        uint32_t const rest_frames = std::min(o1_rest_frames, o2_rest_frames);
+        o1->rest_frames = rest_frames;
+        o2->rest_frames = rest_frames;
+    }
+
+    // motion is integrated by engine for objects with default motion that are
+    // part of the simulation, not static and awake
+    auto update_is_integrated() -> void {
+        slices.is_integrated[slot_] = is_allocation_applied_ &&
+                                      default_motion_ && !is_static_ &&
+                                      !is_sleeping_;
+    }
+
+    // state at previous simulation tick
+    auto previous_position() const -> glm::vec3 const& {
+        return slices.previous_position[slot_];
+    }
+
+    auto previous_orientation() const -> glm::quat const& {
+        return slices.previous_orientation[slot_];
+    }
+
+    // called from 'objects' in thread safe way
     auto clear_handled_collisions() -> void { handled_collisions.clear(); }
 
     // called from 'cell' in thread safe way
     auto is_collision_handled_and_if_not_add(object const* obj) -> bool {
-        bool const found = std::ranges::find(handled_collisions, obj) !=
+        o1handle const handle = obj->handle();
+        bool const found = std::ranges::find(handled_collisions, handle) !=
                            handled_collisions.cend();
 
         if (!found) {
-            handled_collisions.push_back(obj);
+            handled_collisions.push_back(handle);
         }
 
         return found;
@@ -258,8 +585,7 @@ class object {
             planes.acquire_lock();
         }
 
-        glm::mat4 const& M = updated_Mmw();
-        planes.update_model_to_world(g.planes_points, g.planes_normals, M,
+        planes.update_model_to_world(g.planes_points, g.planes_normals, Mmw,
                                      Mmw_pos, Mmw_ori, Mmw_scl);
 
         if (synchronize) {
@@ -267,68 +593,622 @@ class object {
         }
     }
 
-    auto debug_get_Mmw_for_bounding_sphere() const -> glm::mat4 {
-        return glm::scale(glm::translate(glm::mat4(1), Mmw_pos),
-                          glm::vec3{bounding_radius});
+    // called from 'cell' when testing a swept object along its path
+    // sets 'pns' to the planes of the object at 'pos' without changing the
+    // object
+    auto planes_at(glm::vec3 const& pos, class planes& pns) const
+        -> void {
+        class glob const& g = glob();
+        pns.update_model_to_world(g.planes_points, g.planes_normals,
+                                  compose_Mmw(pos, orientation(), scale()),
+                                  pos, orientation(), scale());
     }
 
-    auto acquire_lock() -> void {
-        while (lock.test_and_set(std::memory_order_acquire)) {
+    // called from 'objects' in the batched pass after objects have moved and
+    // when objects are allocated
+    // note: only one thread at a time is active in this section for an object
+    auto update_Mmw() -> void {
+        if (position() == Mmw_pos && orientation() == Mmw_ori &&
+            scale() == Mmw_scl) {
+            return;
         }
+
+        // save the state of the matrix
+        Mmw_pos = position();
+        Mmw_ori = orientation();
+        Mmw_scl = scale();
+
+        Mmw = compose_Mmw(Mmw_pos, Mmw_ori, Mmw_scl);
+    }
+
+    // @return matrix of state interpolated between previous and current
+    //         simulation tick
+    auto interpolated_Mmw(float const alpha) const -> glm::mat4 {
+        glm::vec3 const pos = glm::mix(previous_position(), position(), alpha);
+        glm::quat const ori =
+            glm::slerp(previous_orientation(), orientation(), alpha);
+        return compose_Mmw(pos, ori, scale());
+    }
+
+    // called from 'objects' at the beginning of a simulation tick
+    auto save_previous_state() -> void {
+        slices.previous_position[slot_] = position();
+        slices.previous_orientation[slot_] = orientation();
+    }
+
+    // compose Mmw = T * R * S without multiplying matrices:
+    // the columns of the rotation matrix derived from the quaternion are
+    // scaled and the translation is inserted in the last column
+    static auto compose_Mmw(glm::vec3 const& pos, glm::quat const& ori,
+                            glm::vec3 const& scl) -> glm::mat4 {
+        float const x = ori.x;
+        float const y = ori.y;
+        float const z = ori.z;
+        float const w = ori.w;
+
+        float const xx = x * x;
+        float const yy = y * y;
+        float const zz = z * z;
+        float const xy = x * y;
+        float const xz = x * z;
+        float const yz = y * z;
+        float const wx = w * x;
+        float const wy = w * y;
+        float const wz = w * z;
+
+        float const sx = scl.x;
+        float const sy = scl.y;
+        float const sz = scl.z;
+
+        return {{(1 - 2 * (yy + zz)) * sx, 2 * (xy + wz) * sx,
+                 2 * (xz - wy) * sx, 0},
+                {2 * (xy - wz) * sy, (1 - 2 * (xx + zz)) * sy,
+                 2 * (yz + wx) * sy, 0},
+                {2 * (xz + wy) * sz, 2 * (yz - wx) * sz,
+                 (1 - 2 * (xx + yy)) * sz, 0},
+                {pos, 1}};
+    }
+
+    auto debug_get_Mmw_for_bounding_sphere() const -> glm::mat4 {
+        return glm::scale(glm::translate(glm::mat4(1), Mmw_pos),
+                          glm::vec3{bounding_radius()});
     }
 
-    auto release_lock() -> void { lock.clear(std::memory_order_release); }
+    auto acquire_lock() -> void { lock.lock(); }
+
+    auto release_lock() -> void { lock.unlock(); }
 };
 
 class objects final {
+    // store of a size class
+    template <size_t instance_size_B, uint32_t instance_count, uint32_t id>
+    using store = o1store<object, instance_count, id, false, threaded_grid,
+                          instance_size_B, cache_line_size_B,
+                          objects_max_chunks>;
+
+    using stores = std::tuple<
+        store<objects_small_instance_size_B, objects_small_count, 0>,
+        store<objects_medium_instance_size_B, objects_medium_count, 1>,
+        store<objects_large_instance_size_B, objects_large_count, 2>>;
+
+    static size_t constexpr stores_count = std::tuple_size_v<stores>;
+
+    // size and first index of each size class
+    // note: indexes of size classes follow each other with room for the
+    //       maximum number of chunks
+    static constexpr std::array<size_t, stores_count> store_instance_size_B{
+        objects_small_instance_size_B, objects_medium_instance_size_B,
+        objects_large_instance_size_B};
+    static constexpr std::array<uint32_t, stores_count> store_first_index{
+        0, objects_small_count * objects_max_chunks,
+        (objects_small_count + objects_medium_count) * objects_max_chunks};
+
+    // bits of handle used by index and the rest by generation
+    static uint32_t constexpr handle_index_bits =
+        uint32_t(std::bit_width(objects_count - 1));
+    static uint32_t constexpr handle_index_mask =
+        uint32_t((uint64_t{1} << handle_index_bits) - 1);
+
+    // updates the objects in a list
+    using update_func = void (*)(objects&, std::vector<object*> const&);
+
+    // objects of a concrete type and the function that updates them
+    struct type_entry final {
+        update_func update = nullptr;
+        std::vector<object*> objects{};
+    };
+
+    // object and its sort key when compacting
+    struct compact_entry final {
+        uint64_t key = 0;
+        object* obj = nullptr;
+    };
+
   public:
-    auto init() -> void {}
+    auto init() -> void {
+        // note: type 0 is objects of unknown type updated with virtual call
+        types_[0].update = &update_objects_of_type<object>;
+        // note: slots start in the order of the instances in the stores
+        for (uint32_t i = 0; i < objects_count; ++i) {
+            slots_[i] = i;
+        }
+    }
 
     auto free() -> void {
         for_each([](object* o) { o->~object(); });
         //? what if destructor created objects
+        for (type_entry& te : types_) {
+            te.objects.clear();
+        }
+    }
+
+    // @return uninitialized instance to be constructed with placement new
+    // note: instance is of the largest size class
+    // note: 'update' of the object is dispatched virtually
+    auto alloc() -> object* {
+        return std::get<stores_count - 1>(stores_).allocate_instance();
+    }
+
+    // @return instance of 'type' constructed with default constructor
+    // note: 'update' of the object is dispatched statically in a loop over
+    //       the objects of the same type
+    template <typename type> auto alloc() -> type* {
+        static_assert(std::is_base_of_v<object, type>);
+        static_assert(sizeof(type) <= objects_instance_size_B);
+        static_assert(alignof(type) <= cache_line_size_B);
+
+        size_t constexpr store_ix = size_class_of(sizeof(type));
+        uint32_t const ix = type_ix<type>();
+        type* inst = new (std::get<store_ix>(stores_).allocate_instance())
+            type{};
+        static_cast<object*>(inst)->type_ix_ = ix;
+        return inst;
+    }
+
+    auto free(object* o) -> void {
+        for_each_store_of_index(stores_, o->index_, [o](auto& st, uint32_t) {
+            st.free_instance(o);
+        });
+    }
+
+    auto allocated_list_len() const -> size_t {
+        size_t len = 0;
+        for (uint32_t const store_len : allocated_list_len_) {
+            len += store_len;
+        }
+        return len;
     }
 
-    auto alloc() -> object* { return store_.allocate_instance(); }
+    // @return number of contended operations on the stores since previous
+    //         call
+    auto take_store_contention_count() -> uint32_t {
+        uint32_t count = 0;
+        for_each_store(stores_, [&count](auto& st, size_t) {
+            count += st.take_contention_count();
+        });
+        return count;
+    }
+
+    // @return index of the instance in the stores
+    // note: called from constructor of 'object' thus the size class is found
+    //       from the address
+    // note: throws if 'o' is not an instance in the stores e.g. an object
+    //       not allocated with 'objects.alloc<type>()'
+    auto index_of(object const* o) const -> uint32_t {
+        uint32_t index = 0;
+        bool found = false;
+        for_each_store(stores_,
+                       [o, &index, &found](auto const& st, size_t const ix) {
+                           uint32_t const store_ix = st.index_of(o);
+                           if (store_ix < st.capacity()) {
+                               index = store_first_index[ix] + store_ix;
+                               found = true;
+                           }
+                       });
+        if (!found) {
+            throw exception{std::format(
+                "objects: {} is not an instance in the stores",
+                static_cast<void const*>(o))};
+        }
+        return index;
+    }
+
+    // @return slot in 'slices' of the instance at 'index'
+    // note: slots are permuted by 'compact'
+    auto slot_of(uint32_t const index) const -> uint32_t {
+        return slots_[index];
+    }
+
+    auto handle_of(object const* o) const -> o1handle {
+        uint32_t gen = 0;
+        for_each_store_of_index(
+            stores_, o->index_, [&gen](auto const& st, uint32_t const ix) {
+                gen = st.generation(ix);
+            });
+        return {(gen << handle_index_bits) | o->index_};
+    }
+
+    // @return true if object is allocated and not freed
+    // note: O(1) check of use after free
+    auto is_allocated(object const* o) const -> bool {
+        bool allocated = false;
+        for_each_store_of_index(
+            stores_, o->index_,
+            [o, &allocated](auto const& st, uint32_t) {
+                allocated = st.is_allocated(o);
+            });
+        return allocated;
+    }
 
-    auto free(object* o) -> void { store_.free_instance(o); }
+    // @return object referenced by 'handle' or nullptr if the object has been
+    //         freed
+    auto lookup(o1handle const handle) const -> object* {
+        uint32_t const index = handle.value & handle_index_mask;
+        if (index >= objects_count) {
+            return nullptr;
+        }
+        object* o = nullptr;
+        for_each_store_of_index(
+            stores_, index, [handle, &o](auto const& st, uint32_t const ix) {
+                uint32_t const gen =
+                    st.generation(ix) & (~0u >> handle_index_bits);
+                if ((handle.value >> handle_index_bits) == gen && (gen & 1)) {
+                    o = st.instance(ix);
+                }
+            });
+        return o;
+    }
 
-    auto allocated_list_len() const -> size_t { return allocated_list_len_; }
+    // prints the maximum number of allocated objects of each size class
+    auto print_high_water_marks(FILE* f) const -> void {
+        for_each_store(stores_, [f](auto const& st, size_t const ix) {
+            fprintf(f,
+                    "objects %4zu B: high-water mark: %u  chunks: %u  "
+                    "capacity: %zu\n",
+                    store_instance_size_B[ix], st.high_water_mark(),
+                    st.chunks_count(), st.capacity());
+        });
+    }
 
     auto for_each(auto&& func) -> void {
-        for (object** it = store_.allocated_list(); it < allocated_list_end_;
-             ++it) {
-            object* obj = *it;
-            func(obj);
+        for_each_store(stores_, [this, &func](auto& st, size_t const ix) {
+            for (object** it = st.allocated_list();
+                 it < allocated_list_end_[ix]; ++it) {
+                object* obj = *it;
+                func(obj);
+            }
+        });
+    }
+
+    // calls 'func(begin, end)' with the applied allocated list of each size
+    // class
+    auto for_each_list(auto&& func) -> void {
+        for_each_store(stores_, [this, &func](auto& st, size_t const ix) {
+            func(st.allocated_list(), allocated_list_end_[ix]);
+        });
+    }
+
+    // calls 'update' on objects that are awake type by type
+    // note: objects freed during update are removed from the lists at
+    //       'apply_freed_instances' and objects allocated are added at
+    //       'apply_allocated_instances'
+    auto update() -> void {
+        uint32_t const types_len = types_len_.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < types_len; ++i) {
+            type_entry const& te = types_[i];
+            if (!te.objects.empty()) {
+                te.update(*this, te.objects);
+            }
         }
     }
 
+    // rebuilds the model-to-world matrices of objects that have moved
+    // note: each object is visited once and the composition does not
+    //       synchronize thus the pass can be parallel and vectorized
+    auto update_Mmw_matrices() -> void {
+        for_each_store(stores_, [this](auto& st, size_t const ix) {
+            object** const begin = st.allocated_list();
+            object** const end = allocated_list_end_[ix];
+            if (threaded_grid) {
+                std::for_each(std::execution::par_unseq, begin, end,
+                              [](object* o) { o->update_Mmw(); });
+            } else {
+                std::for_each(std::execution::unseq, begin, end,
+                              [](object* o) { o->update_Mmw(); });
+            }
+        });
+    }
+
+    // copies the matrices to render to the buffer read by render thread when
+    // 'threaded_update'
+    // note: called from update thread while render thread waits
+    auto buffer_rendered_matrices() -> void {
+        for_each_list([](object** const begin, object** const end) {
+            auto const buffer = [](object* o) {
+                o->rendered_Mmw_ = o->current_rendered_Mmw();
+            };
+            if (threaded_grid) {
+                std::for_each(std::execution::par_unseq, begin, end, buffer);
+            } else {
+                std::for_each(std::execution::unseq, begin, end, buffer);
+            }
+        });
+    }
+
+    // integrates motion of objects with default motion in one pass over the
+    // live slots and saves the state at the beginning of the simulation tick
+    // note: the allocated instances are found from the bitmaps of the stores
+    //       thus slots that are not in use are not visited
+    // note: slots are independent thus the pass can be parallel
+    auto integrate_motion() -> void {
+        float const dt = frame_context.dt;
+        auto const integrate = [dt](object const* o) {
+            uint32_t const slot = o->slot_;
+            if (!slices.is_integrated[slot]) {
+                return;
+            }
+            slices.previous_position[slot] = slices.position[slot];
+            slices.previous_orientation[slot] = slices.orientation[slot];
+            slices.integrate(slot, dt);
+        };
+        bool const parallel =
+            threaded_grid &&
+            allocated_list_len() >= integrate_motion_parallel_min_objects;
+        for_each_store(stores_, [parallel, &integrate](auto const& st,
+                                                       size_t) {
+            if (parallel) {
+                st.for_each_allocated(std::execution::par_unseq, integrate);
+            } else {
+                st.for_each_allocated(std::execution::unseq, integrate);
+            }
+        });
+    }
+
     auto apply_allocated_instances(auto&& callback) -> void {
-        // retrieve the end of list because during objects' 'update' and
-        // 'on_collision' new objects might be created which would change the
-        // end-of-list pointer
-        object** alloc_iter = store_.allocated_list() + allocated_list_len_;
-        object** const alloc_end = store_.allocated_list_end();
-        while (alloc_iter < alloc_end) {
-            object* o = *alloc_iter;
-            callback(o);
-            ++alloc_iter;
-        }
-        allocated_list_len_ = store_.allocated_list_len();
-        allocated_list_end_ = alloc_end;
+        for_each_store(stores_, [this, &callback](auto& st, size_t const ix) {
+            // retrieve the end of list because during objects' 'update' and
+            // 'on_collision' new objects might be created which would change
+            // the end-of-list pointer
+            object** alloc_iter = st.allocated_list() + allocated_list_len_[ix];
+            object** const alloc_end = st.allocated_list_end();
+            while (alloc_iter < alloc_end) {
+                object* o = *alloc_iter;
+                // matrix of new object is valid before it is rendered
+                o->update_Mmw();
+                o->save_previous_state();
+                o->rendered_Mmw_ = o->Mmw;
+                o->is_allocation_applied_ = true;
+                o->update_is_integrated();
+                add_to_type_list(o);
+                callback(o);
+                ++alloc_iter;
+            }
+            allocated_list_len_[ix] = st.allocated_list_len();
+            allocated_list_end_[ix] = alloc_end;
+        });
     }
 
     // free instances and call their destructors
     auto apply_freed_instances(auto&& callback) -> void {
-        store_.apply_free(callback);
+        for_each_store(stores_, [this, &callback](auto& st, size_t) {
+            st.apply_free([this, &callback](object* o) {
+                if (o->is_allocation_applied_) {
+                    remove_from_type_list(o);
+                }
+                callback(o);
+            });
+        });
+    }
+
+    // orders the applied objects of each size class and their state in
+    // 'slices' by 'key(object const*) -> uint64_t'
+    // note: the instances are not moved thus pointers and handles stay valid.
+    //       the allocated lists, the type lists and the slots are reordered
+    //       so that the passes visit objects with close keys next to each
+    //       other in memory
+    // note: called from one thread when no pass is running
+    auto compact(auto&& key) -> void {
+        compact_from_.clear();
+        compact_to_.clear();
+        for_each_store(stores_, [this, &key](auto& st, size_t const ix) {
+            object** const list = st.allocated_list();
+            uint32_t const len = uint32_t(allocated_list_end_[ix] - list);
+            compact_entries_.clear();
+            for (uint32_t i = 0; i < len; ++i) {
+                compact_entries_.push_back({key(list[i]), list[i]});
+            }
+            std::ranges::sort(compact_entries_, {}, &compact_entry::key);
+
+            // slots of the objects are handed out again in key order
+            size_t const first = compact_to_.size();
+            for (uint32_t i = 0; i < len; ++i) {
+                object* o = compact_entries_[i].obj;
+                list[i] = o;
+                o->alloc_ptr = &list[i];
+                compact_from_.push_back(o->slot_);
+                compact_to_.push_back(o->slot_);
+            }
+            std::sort(compact_to_.begin() + ptrdiff_t(first),
+                      compact_to_.end());
+            for (uint32_t i = 0; i < len; ++i) {
+                object* o = compact_entries_[i].obj;
+                o->slot_ = compact_to_[first + i];
+                slots_[o->index_] = o->slot_;
+            }
+        });
+
+        slices.move(compact_from_, compact_to_);
+
+        // objects of a type are updated in slot order
+        uint32_t const types_len = types_len_.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < types_len; ++i) {
+            std::vector<object*>& list = types_[i].objects;
+            std::ranges::sort(list, {}, &object::slot_);
+            for (uint32_t j = 0; j < list.size(); ++j) {
+                list[j]->type_list_ix_ = j;
+            }
+        }
     }
 
   private:
-    o1store<object, objects_count, 0, false, threaded_grid,
-            objects_instance_size_B, cache_line_size_B>
-        store_{};
-    object** allocated_list_end_ = nullptr;
-    uint32_t allocated_list_len_ = 0;
+    // @return index of smallest size class that fits 'size_B'
+    static constexpr auto size_class_of(size_t const size_B) -> size_t {
+        size_t ix = 0;
+        while (store_instance_size_B[ix] < size_B) {
+            ++ix;
+        }
+        return ix;
+    }
+
+    // calls 'func(store, index)' for each size class in 'sts'
+    // note: 'sts' is 'stores_' or const 'stores_'
+    static auto for_each_store(auto& sts, auto&& func) -> void {
+        [&sts, &func]<size_t... ix>(std::index_sequence<ix...>) {
+            (func(std::get<ix>(sts), ix), ...);
+        }(std::make_index_sequence<stores_count>{});
+    }
+
+    // calls 'func(store, index_in_store)' for the size class of 'index'
+    static auto for_each_store_of_index(auto& sts, uint32_t const index,
+                                        auto&& func) -> void {
+        for_each_store(sts, [index, &func](auto& st, size_t const ix) {
+            if (index >= store_first_index[ix] &&
+                index - store_first_index[ix] < st.capacity()) {
+                func(st, index - store_first_index[ix]);
+            }
+        });
+    }
+
+    // @return index of 'type' in registry. registered at first call
+    template <typename type> auto type_ix() -> uint32_t {
+        if constexpr (std::is_same_v<type, object>) {
+            return 0;
+        } else {
+            static uint32_t const ix =
+                register_type(&update_objects_of_type<type>);
+            return ix;
+        }
+    }
+
+    auto register_type(update_func const func) -> uint32_t {
+        // note: objects of a new type may be allocated during 'update' from
+        //       several threads
+        uint32_t const ix = types_len_.fetch_add(1);
+        if (ix >= objects_max_types) {
+            throw exception{std::format("objects: more than {} types",
+                                        objects_max_types)};
+        }
+        types_[ix].update = func;
+        return ix;
+    }
+
+    // note: called from one thread
+    auto add_to_type_list(object* o) -> void {
+        std::vector<object*>& list = types_[o->type_ix_].objects;
+        o->type_list_ix_ = uint32_t(list.size());
+        list.push_back(o);
+    }
+
+    // note: called from one thread
+    auto remove_from_type_list(object* o) -> void {
+        std::vector<object*>& list = types_[o->type_ix_].objects;
+        object* last = list.back();
+        last->type_list_ix_ = o->type_list_ix_;
+        list[o->type_list_ix_] = last;
+        list.pop_back();
+    }
+
+    // note: objects in list are independent thus the loop can be parallel
+    template <typename type>
+    static auto update_objects_of_type(objects& objs,
+                                       std::vector<object*> const& list)
+        -> void {
+        auto const update = [&objs](object* o) {
+            objs.update_object(o, [](object* obj) {
+                if constexpr (std::is_same_v<type, object>) {
+                    return obj->update();
+                } else {
+                    return static_cast<type*>(obj)->type::update();
+                }
+            });
+        };
+        if (threaded_grid) {
+            // note: not `par_unseq` because 'update' may synchronize
+            std::for_each(std::execution::par, list.cbegin(), list.cend(),
+                          update);
+        } else {
+            std::for_each(list.cbegin(), list.cend(), update);
+        }
+    }
+
+    // note: only one thread at a time is active for 'o'
+    auto update_object(object* o, auto&& update) -> void {
+        // note: objects free themselves after their update thus an object in
+        //       a type list is allocated until the list is applied
+        assert(is_allocated(o));
+
+        if ((fixed_time_step || o->is_swept) &&
+            !slices.is_integrated[o->slot_]) {
+            // save state for render to interpolate between and for
+            // continuous collision detection
+            // note: saved by 'integrate_motion()' for integrated objects
+            o->save_previous_state();
+        }
+
+        if (o->is_sleeping_) {
+            if (!o->has_motion()) {
+                // note: sleeping object is not updated but the list is
+                //       cleared prior to 'resolve_collisions'
+                o->clear_handled_collisions();
+                return;
+            }
+            // velocity or acceleration set while sleeping e.g. by application
+            // wakes the object
+            // note: motion of this frame is integrated here because the
+            //       batched pass skipped the sleeping object
+            o->wake();
+            if (slices.is_integrated[o->slot_]) {
+                o->integrate_motion();
+            }
+        }
+
+        if (!update(o)) {
+            o->is_dead = true;
+            free(o);
+            return;
+        }
+
+        o->update_sleep_state();
+
+        // note: opportunity to clear the list prior to 'resolve_collisions'
+        o->clear_handled_collisions();
+    }
+
+    stores stores_{};
+    // per size class
+    std::array<object**, stores_count> allocated_list_end_{};
+    std::array<uint32_t, stores_count> allocated_list_len_{};
+    // registry of concrete types of objects
+    std::array<type_entry, objects_max_types> types_{};
+    std::atomic<uint32_t> types_len_ = 1; // note: type 0 is unknown type
+    // slot in 'slices' of instance at index in stores
+    std::array<uint32_t, objects_count> slots_{};
+    // used by 'compact'
+    std::vector<compact_entry> compact_entries_{};
+    std::vector<uint32_t> compact_from_{};
+    std::vector<uint32_t> compact_to_{};
 } static objects{};
 
+static auto object_index(object const* o) -> uint32_t {
+    return objects.index_of(o);
+}
+
+static auto object_slot(uint32_t const index) -> uint32_t {
+    return objects.slot_of(index);
+}
+
+static auto object_handle(object const* o) -> o1handle {
+    return objects.handle_of(o);
+}
+
 } // namespace glos
@@ -11,6 +11,7 @@
 #define GLM_ENABLE_EXPERIMENTAL
 
 #include "decouple.hpp"
+#include "spinlock.hpp"
 #include <algorithm>
 #include <atomic>
 #include <glm/glm.hpp>
@@ -32,12 +33,14 @@ class planes final {
     glm::quat Mmw_ori{};
     glm::vec3 Mmw_scl{};
     //
-    std::atomic_flag lock = ATOMIC_FLAG_INIT;
+    spinlock<lock_site::planes> lock{};
 
   public:
     struct collision final {
         glm::vec3 point;
         glm::vec3 normal;
+        float depth = 0;      // distance of point behind plane
+        uint32_t feature = 0; // point and plane index identifying the contact
     };
 
     bool invalidated = true;
@@ -151,11 +154,13 @@ class planes final {
                                 glm::vec3 const& relative_velocity) const
         -> std::optional<collision> {
 
+        uint32_t point_ix = 0;
         for (glm::vec4 const& point : world_points) {
-            if (std::optional<glm::vec3> const normal =
+            if (std::optional<uint32_t> const plane_ix =
                     pns.is_point_in_volume(point, relative_velocity)) {
-                return collision{point, *normal};
+                return pns.make_collision(point, point_ix, *plane_ix);
             }
+            ++point_ix;
         }
 
         return std::nullopt;
@@ -168,24 +173,28 @@ class planes final {
 
         std::vector<collision> collisions{};
 
+        uint32_t point_ix = 0;
         for (glm::vec4 const& point : world_points) {
-            if (std::optional<glm::vec3> const normal =
+            if (std::optional<uint32_t> const plane_ix =
                     pns.is_point_in_volume(point, relative_velocity)) {
-                collisions.emplace_back(point, *normal);
+                collisions.emplace_back(
+                    pns.make_collision(point, point_ix, *plane_ix));
             }
+            ++point_ix;
         }
 
         return collisions;
     }
 
     // assumes updated planes to world coordinate system
-    // @return the normal of the plane colliding with point
+    // @return the index of the plane colliding with point
     auto is_point_in_volume(glm::vec4 const& point,
                             glm::vec3 const& relative_velocity) const
-        -> std::optional<glm::vec3> {
+        -> std::optional<uint32_t> {
 
         float best_score = std::numeric_limits<float>::lowest();
-        glm::vec3 best_normal = glm::vec3{};
+        uint32_t best_plane_ix = 0;
+        uint32_t plane_ix = 0;
 
         // weights to balance distance vs normal dot velocity
         // float const w_depth = 0.2f;
@@ -213,11 +222,25 @@ class planes final {
 
             if (score > best_score) {
                 best_score = score;
-                best_normal = normal;
+                best_plane_ix = plane_ix;
             }
+            ++plane_ix;
         }
 
-        return best_normal;
+        if (world_planes.empty()) {
+            return std::nullopt;
+        }
+
+        return best_plane_ix;
+    }
+
+    // @return collision of 'point' at index 'point_ix' in other planes with
+    //         plane at 'plane_ix'
+    auto make_collision(glm::vec4 const& point, uint32_t const point_ix,
+                        uint32_t const plane_ix) const -> collision {
+        glm::vec4 const& plane = world_planes[plane_ix];
+        return {point, glm::vec3{plane}, -glm::dot(plane, point),
+                point_ix << 16 | plane_ix};
     }
 
     // works in cases where the sphere is much smaller than the convex volume
@@ -241,6 +264,88 @@ class planes final {
             });
     }
 
+    // assumes updated planes to world coordinate system
+    // @return shortest distance from 'point' within the volume to the planes
+    auto distance_to_nearest_plane(glm::vec3 const& point) const -> float {
+        float distance = std::numeric_limits<float>::max();
+        for (glm::vec4 const& plane : world_planes) {
+            glm::vec3 const n = glm::vec3{plane};
+            float const d = -(glm::dot(n, point) + plane.w) / glm::length(n);
+            distance = std::min(distance, d);
+        }
+        return distance;
+    }
+
+    struct time_of_impact final {
+        float time;       // fraction of 'displacement' [0, 1]
+        glm::vec3 normal; // unit normal of the plane hit
+    };
+
+    // sphere moving from 'position' by 'displacement' vs the volume
+    // note: the path of the center is clipped against the planes moved out by
+    //       'radius' (Cyrus-Beck). same false positives at corners as in
+    //       'are_in_collision_with_sphere'
+    // @return time of impact if the sphere enters or starts in the volume
+    auto swept_sphere_time_of_impact(glm::vec3 const& position,
+                                     glm::vec3 const& displacement,
+                                     float const radius) const
+        -> std::optional<time_of_impact> {
+
+        if (world_planes.empty()) {
+            return std::nullopt;
+        }
+
+        float t_enter = 0;
+        float t_exit = 1;
+        glm::vec3 normal{};
+        bool has_entering_plane = false;
+        // in case the sphere starts within the volume the least penetrated
+        // plane is used as normal
+        float max_start_distance = std::numeric_limits<float>::lowest();
+
+        for (glm::vec4 const& plane : world_planes) {
+            glm::vec3 const n = glm::vec3{plane};
+            float const offset = radius * glm::length(n);
+            // distance from the moved out plane at start and end of path
+            float const d0 = glm::dot(n, position) + plane.w - offset;
+            float const d1 = d0 + glm::dot(n, displacement);
+
+            if (d0 > 0 && d1 > 0) {
+                // path is entirely in front of plane
+                return std::nullopt;
+            }
+
+            if (d0 <= 0 && !has_entering_plane && d0 > max_start_distance) {
+                max_start_distance = d0;
+                normal = n;
+            }
+
+            if (d1 <= 0 && d0 <= 0) {
+                // path is entirely behind plane
+                continue;
+            }
+
+            float const t = d0 / (d0 - d1);
+            if (d0 > 0) {
+                // path enters through plane
+                if (!has_entering_plane || t > t_enter) {
+                    t_enter = t;
+                    normal = n;
+                }
+                has_entering_plane = true;
+            } else {
+                // path exits through plane
+                t_exit = std::min(t_exit, t);
+            }
+
+            if (t_enter > t_exit) {
+                return std::nullopt;
+            }
+        }
+
+        return time_of_impact{t_enter, glm::normalize(normal)};
+    }
+
     // // note: gives false positives. works in 2D. (not used)
     // auto
     // are_in_collision_with_sphere_sat(glm::vec3 const &position,
@@ -322,12 +427,9 @@ class planes final {
     //   return true;
     // }
 
-    auto acquire_lock() -> void {
-        while (lock.test_and_set(std::memory_order_acquire)) {
-        }
-    }
+    auto acquire_lock() -> void { lock.lock(); }
 
-    auto release_lock() -> void { lock.clear(std::memory_order_release); }
+    auto release_lock() -> void { lock.unlock(); }
 };
 
 } // namespace glos
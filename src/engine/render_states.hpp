@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace glos {
+
+// state of a frame needed by render thread when 'threaded_update_pipelined'
+// note: copied from objects by update thread at the end of the frame thus
+//       render does not read objects while they are being updated
+class render_state final {
+  public:
+    struct entry final {
+        glm::mat4 Mmw{}; // model -> world matrix to render with
+        uint32_t glob_ix = 0;
+    };
+
+    std::vector<entry> entries{};
+    glm::vec3 camera_look_at{};
+    bool is_camera_following = false; // true if 'camera_look_at' is valid
+    uint32_t allocated_objects = 0;   // for metrics
+};
+
+// triple buffer of render states handed from update to render thread without
+// locks
+// * update thread writes the back state while render thread reads the front
+//   state
+// * the middle state is the latest published. it is exchanged with the back
+//   state at 'publish' and with the front state at 'take'
+// * the index of the middle state and flags are kept in one atomic that the
+//   threads wait on and notify
+class render_states final {
+    static uint32_t constexpr index_mask = 3;
+    static uint32_t constexpr is_fresh = 4;   // middle is not taken by render
+    static uint32_t constexpr is_stopped = 8; // 'stop' has been called
+
+    std::array<render_state, 3> states_{};
+    std::atomic<uint32_t> middle_ = 1;
+    uint32_t back_ = 0;  // used by update thread
+    uint32_t front_ = 2; // used by render thread
+
+  public:
+    // called from update thread
+    auto back() -> render_state& { return states_[back_]; }
+
+    // called from update thread
+    // waits until render thread has taken the previously published state then
+    // publishes the back state
+    // @return false if stopped
+    auto publish() -> bool {
+        uint32_t mid = middle_.load(std::memory_order_acquire);
+        while (true) {
+            if (mid & is_stopped) {
+                return false;
+            }
+            if (mid & is_fresh) {
+                middle_.wait(mid, std::memory_order_acquire);
+                mid = middle_.load(std::memory_order_acquire);
+                continue;
+            }
+            if (middle_.compare_exchange_weak(mid, back_ | is_fresh,
+                                              std::memory_order_acq_rel,
+                                              std::memory_order_acquire)) {
+                back_ = mid & index_mask;
+                middle_.notify_one();
+                return true;
+            }
+        }
+    }
+
+    // called from render thread
+    // waits until a state is published then makes it the front state
+    // @return front state or nullptr if stopped
+    auto take() -> render_state const* {
+        uint32_t mid = middle_.load(std::memory_order_acquire);
+        while (true) {
+            if (mid & is_stopped) {
+                return nullptr;
+            }
+            if (!(mid & is_fresh)) {
+                middle_.wait(mid, std::memory_order_acquire);
+                mid = middle_.load(std::memory_order_acquire);
+                continue;
+            }
+            if (middle_.compare_exchange_weak(mid, front_,
+                                              std::memory_order_acq_rel,
+                                              std::memory_order_acquire)) {
+                front_ = mid & index_mask;
+                middle_.notify_one();
+                return &states_[front_];
+            }
+        }
+    }
+
+    // wakes and stops threads waiting in 'publish' or 'take'
+    auto stop() -> void {
+        middle_.fetch_or(is_stopped, std::memory_order_acq_rel);
+        middle_.notify_all();
+    }
+};
+
+} // namespace glos
@@ -0,0 +1,269 @@
+#pragma once
+
+#include "decouple.hpp"
+#include "objects.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <execution>
+#include <functional>
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace glos {
+
+// sequential impulse solver of contacts between convex volumes
+// * contacts found by cells are gathered and duplicates, found by several
+//   cells when objects overlap cells, are removed
+// * a contact is identified by the objects and the point and plane in
+//   contact. the accumulated impulse of a contact is kept to next frame and
+//   applied before iterating (warm starting)
+// * penetration is corrected by biasing the target velocity along the normal
+//   (Baumgarte stabilization)
+// * contacts are colored so that no two contacts of a color share an object
+//   that is not static. contacts of a color are solved in parallel without
+//   locks when 'threaded_grid' is enabled
+class solver final {
+    // contacts that do not fit in a color are solved sequentially last
+    static uint32_t constexpr max_colors = 64;
+
+    // note: objects are identified by handles thus a contact of an object
+    //       freed and a new object allocated in the same slot between frames
+    //       does not inherit the accumulated impulse
+    struct contact_id final {
+        o1handle o1{};
+        o1handle o2{};
+        uint32_t feature = 0;
+
+        auto operator==(contact_id const&) const -> bool = default;
+    };
+
+    struct contact_id_hash final {
+        auto operator()(contact_id const& id) const -> size_t {
+            size_t h = std::hash<uint32_t>{}(id.o1.value);
+            h ^= std::hash<uint32_t>{}(id.o2.value) + 0x9e3779b9 + (h << 6) +
+                 (h >> 2);
+            h ^= std::hash<uint32_t>{}(id.feature) + 0x9e3779b9 + (h << 6) +
+                 (h >> 2);
+            return h;
+        }
+    };
+
+    struct contact final {
+        contact_id id{};
+        object* o1 = nullptr;  // owner of normal
+        object* o2 = nullptr;  // owner of point
+        glm::vec3 point{};     // point of contact in world coordinates
+        glm::vec3 normal{};    // points from o1 towards o2
+        float depth = 0;       // penetration
+        glm::vec3 r1{};        // offset from center of o1 to point
+        glm::vec3 r2{};        // offset from center of o2 to point
+        glm::vec3 angular1{};  // change of o1 angular velocity per impulse
+        glm::vec3 angular2{};  // change of o2 angular velocity per impulse
+        float normal_mass = 0; // inverted effective mass along normal
+        float bias = 0;        // target relative velocity along normal
+        float impulse = 0;     // accumulated impulse along normal
+        uint32_t color = 0;    // contacts of a color share no moving object
+    };
+
+    std::vector<contact> contacts{};
+    std::vector<contact> colored_contacts{}; // used when sorting by color
+    // index in 'contacts' of first contact of color and one past last color
+    std::array<size_t, max_colors + 2> color_offsets{};
+    // accumulated impulses of contacts in previous and current frame
+    // note: current frame map is also used to remove duplicate contacts
+    std::unordered_map<contact_id, float, contact_id_hash> previous_impulses{};
+    std::unordered_map<contact_id, float, contact_id_hash> current_impulses{};
+
+  public:
+    auto init() -> void {}
+
+    auto free() -> void {
+        contacts.clear();
+        previous_impulses.clear();
+        current_impulses.clear();
+    }
+
+    // called from grid (from only one thread)
+    auto add(object* o1, object* o2, glm::vec3 const& point,
+             glm::vec3 const& normal, float const depth, uint32_t const feature)
+        -> void {
+
+        contact_id const id{o1->handle(), o2->handle(), feature};
+        if (!current_impulses.try_emplace(id, 0.0f).second) {
+            // contact already added by a different cell
+            return;
+        }
+        contacts.push_back({.id = id,
+                            .o1 = o1,
+                            .o2 = o2,
+                            .point = point,
+                            .normal = normal,
+                            .depth = depth});
+    }
+
+    // called from grid (from only one thread)
+    auto solve() -> void {
+        float const dt = frame_context.dt;
+
+        color_contacts();
+
+        for_each_contact_by_color(
+            [this, dt](contact& c) { prepare(c, dt); });
+
+        for (uint32_t i = 0; i < contact_solver_iterations; ++i) {
+            for_each_contact_by_color(
+                [](contact& c) { solve_contact(c); });
+        }
+
+        // save accumulated impulses for warm starting next frame
+        for (contact const& c : contacts) {
+            current_impulses[c.id] = c.impulse;
+        }
+        std::swap(previous_impulses, current_impulses);
+        current_impulses.clear();
+        contacts.clear();
+    }
+
+  private:
+    // greedy coloring in the order contacts were added
+    // note: static objects are not written to and do not constrain the color
+    auto color_contacts() -> void {
+        std::array<size_t, max_colors + 1> counts{};
+        for (contact& c : contacts) {
+            uint64_t const used = c.o1->solver_colors | c.o2->solver_colors;
+            uint32_t const color = uint32_t(std::countr_one(used));
+            // note: 'max_colors' if all colors are used
+            c.color = color;
+            ++counts[color];
+            if (color == max_colors) {
+                continue;
+            }
+            uint64_t const bit = uint64_t{1} << color;
+            if (!c.o1->is_static_) {
+                c.o1->solver_colors |= bit;
+            }
+            if (!c.o2->is_static_) {
+                c.o2->solver_colors |= bit;
+            }
+        }
+
+        for (contact const& c : contacts) {
+            c.o1->solver_colors = 0;
+            c.o2->solver_colors = 0;
+        }
+
+        // stable sort by color
+        color_offsets[0] = 0;
+        for (uint32_t i = 0; i <= max_colors; ++i) {
+            color_offsets[i + 1] = color_offsets[i] + counts[i];
+        }
+        std::array<size_t, max_colors + 1> next{};
+        std::copy_n(color_offsets.cbegin(), next.size(), next.begin());
+        colored_contacts.resize(contacts.size());
+        for (contact const& c : contacts) {
+            colored_contacts[next[c.color]++] = c;
+        }
+        std::swap(contacts, colored_contacts);
+    }
+
+    // colors are done in sequence and contacts within a color in parallel
+    auto for_each_contact_by_color(auto&& func) -> void {
+        for (uint32_t color = 0; color <= max_colors; ++color) {
+            contact* begin = contacts.data() + color_offsets[color];
+            contact* end = contacts.data() + color_offsets[color + 1];
+            if (begin == end) {
+                continue;
+            }
+            if (threaded_grid && color != max_colors) {
+                std::for_each(std::execution::par, begin, end, func);
+            } else {
+                std::for_each(begin, end, func);
+            }
+        }
+    }
+
+    auto prepare(contact& c, float const dt) const -> void {
+        object* o1 = c.o1;
+        object* o2 = c.o2;
+
+        object::propagate_rest_state(o1, o2);
+
+        c.r1 = c.point - o1->position();
+        c.r2 = c.point - o2->position();
+
+        glm::mat3 const& InvI1w = o1->updated_invIw();
+        glm::mat3 const& InvI2w = o2->updated_invIw();
+
+        c.angular1 = InvI1w * glm::cross(c.r1, c.normal);
+        c.angular2 = InvI2w * glm::cross(c.r2, c.normal);
+
+        // k = m1^-1 + m2^-1 + (I1^-1(r1 × n) × r1 + I2^-1(r2 × n) × r2) · n
+        float const k =
+            o1->inv_mass() + o2->inv_mass() +
+            glm::dot(glm::cross(c.angular1, c.r1) + glm::cross(c.angular2, c.r2),
+                     c.normal);
+        c.normal_mass = k > 0 ? 1 / k : 0;
+
+        // push objects apart by a fraction of the penetration every frame
+        // note: no correction when no time passes e.g. first frame or paused
+        c.bias = dt > 0 ? contact_baumgarte / dt *
+                              std::max(c.depth - contact_slop, 0.0f)
+                        : 0;
+
+        // bounce using relative velocity before any impulse is applied
+        float const relative_velocity_along_normal = relative_velocity(c);
+        if (relative_velocity_along_normal < -contact_restitution_threshold) {
+            c.bias = std::max(c.bias, -contact_restitution *
+                                          relative_velocity_along_normal);
+        }
+
+        // warm start
+        auto const it = previous_impulses.find(c.id);
+        c.impulse = it != previous_impulses.cend() ? it->second : 0;
+        apply_impulse(c, c.impulse);
+    }
+
+    static auto solve_contact(contact& c) -> void {
+        float const impulse =
+            c.normal_mass * (c.bias - relative_velocity(c));
+
+        // clamp accumulated impulse because contact can only push
+        float const accumulated = std::max(c.impulse + impulse, 0.0f);
+        float const delta = accumulated - c.impulse;
+        c.impulse = accumulated;
+
+        apply_impulse(c, delta);
+    }
+
+    // @return relative velocity along normal at contact point
+    static auto relative_velocity(contact const& c) -> float {
+        // velocity at contact point: v_p = v + ω × r
+        glm::vec3 const v_p1 = c.o1->linear_velocity() +
+                               glm::cross(c.o1->angular_velocity(), c.r1);
+        glm::vec3 const v_p2 = c.o2->linear_velocity() +
+                               glm::cross(c.o2->angular_velocity(), c.r2);
+        return glm::dot(v_p2 - v_p1, c.normal);
+    }
+
+    static auto apply_impulse(contact const& c, float const impulse) -> void {
+        // v'_1 = v_1 - j / m1,  ω'_1 = ω_1 - I_1^-1 (r_1 × j)
+        // v'_2 = v_2 + j / m2,  ω'_2 = ω_2 + I_2^-1 (r_2 × j)
+        // note: static objects are not written to because they may be in
+        //       contacts solved in parallel
+        glm::vec3 const j = impulse * c.normal;
+        if (!c.o1->is_static_) {
+            c.o1->linear_velocity() -= j * c.o1->inv_mass();
+            c.o1->angular_velocity() -= c.angular1 * impulse;
+        }
+        if (!c.o2->is_static_) {
+            c.o2->linear_velocity() += j * c.o2->inv_mass();
+            c.o2->angular_velocity() += c.angular2 * impulse;
+        }
+    }
+} static solver{};
+
+} // namespace glos
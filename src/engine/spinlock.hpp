@@ -0,0 +1,135 @@
+#pragma once
+
+#include "../application/configuration.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace glos {
+
+// places in engine that use a spinlock
+// note: counted separately when 'spinlock_counters_enabled'
+enum class lock_site : uint32_t {
+    object,       // 'object::acquire_lock'
+    object_invIw, // 'object::updated_invIw'
+    planes,       // 'planes::acquire_lock'
+    o1store_grow, // 'o1store::grow'
+    count
+};
+
+static uint32_t constexpr lock_sites_count = uint32_t(lock_site::count);
+
+// short names of lock sites used in 'metrics'
+static std::array<char const*, lock_sites_count> constexpr lock_site_names{
+    "obj", "inv", "pln", "grw"};
+
+// acquisitions and spins of each lock site when 'spinlock_counters_enabled'
+class spinlock_counters final {
+    struct counters final {
+        alignas(cache_line_size_B) std::atomic<uint32_t> acquisitions = 0;
+        std::atomic<uint32_t> spins = 0;
+    };
+
+    std::array<counters, lock_sites_count> sites_{};
+
+  public:
+    auto add(lock_site const site, uint32_t const spins) -> void {
+        counters& c = sites_[uint32_t(site)];
+        c.acquisitions.fetch_add(1, std::memory_order_relaxed);
+        if (spins) {
+            c.spins.fetch_add(spins, std::memory_order_relaxed);
+        }
+    }
+
+    // copies the counts since previous call to 'acquisitions' and 'spins'
+    auto take(std::array<uint32_t, lock_sites_count>& acquisitions,
+              std::array<uint32_t, lock_sites_count>& spins) -> void {
+        for (uint32_t i = 0; i < lock_sites_count; ++i) {
+            acquisitions[i] =
+                sites_[i].acquisitions.exchange(0, std::memory_order_relaxed);
+            spins[i] = sites_[i].spins.exchange(0, std::memory_order_relaxed);
+        }
+    }
+} static spinlock_counters{};
+
+// hints the cpu that the thread is spinning
+static auto cpu_pause() -> void {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield");
+#endif
+}
+
+// lock for short critical sections
+// * test-and-test-and-set: spins reading the lock and tries to take it only
+//   when it looks free to avoid invalidating the cache line of the holder
+// * exponential backoff of pause instructions up to 'spinlock_max_backoff'
+// * after 'spinlock_spins_before_wait' spins the thread waits on the lock
+//   (futex) and is woken by 'unlock'
+// note: acquisitions and spins are counted per 'site' when
+//       'spinlock_counters_enabled'
+template <lock_site site> class spinlock final {
+    // 0: unlocked, 1: locked, 2: locked and there might be waiting threads
+    std::atomic<uint32_t> state_ = 0;
+
+  public:
+    auto lock() -> void {
+        uint32_t const spins = acquire();
+        if (spinlock_counters_enabled) {
+            spinlock_counters.add(site, spins);
+        }
+    }
+
+    auto unlock() -> void {
+        if (state_.exchange(0, std::memory_order_release) == 2) {
+            state_.notify_one();
+        }
+    }
+
+  private:
+    // @return number of spins before the lock was taken
+    auto acquire() -> uint32_t {
+        uint32_t expected = 0;
+        if (state_.compare_exchange_strong(expected, 1,
+                                           std::memory_order_acquire,
+                                           std::memory_order_relaxed)) {
+            return 0;
+        }
+
+        uint32_t spins = 0;
+        uint32_t backoff = 1;
+        while (true) {
+            while (state_.load(std::memory_order_relaxed) != 0) {
+                if (spinlock_spins_before_wait &&
+                    spins >= spinlock_spins_before_wait) {
+                    return acquire_waiting(spins);
+                }
+                for (uint32_t i = 0; i < backoff; ++i) {
+                    cpu_pause();
+                }
+                backoff = std::min(backoff * 2, spinlock_max_backoff);
+                ++spins;
+            }
+            expected = 0;
+            if (state_.compare_exchange_weak(expected, 1,
+                                             std::memory_order_acquire,
+                                             std::memory_order_relaxed)) {
+                return spins;
+            }
+        }
+    }
+
+    // note: once a thread has waited the lock is taken marked as having
+    //       waiters so that 'unlock' wakes the next waiting thread
+    auto acquire_waiting(uint32_t spins) -> uint32_t {
+        while (state_.exchange(2, std::memory_order_acquire) != 0) {
+            state_.wait(2, std::memory_order_relaxed);
+            ++spins;
+        }
+        return spins;
+    }
+};
+
+} // namespace glos
@@ -0,0 +1,202 @@
+#pragma once
+
+#include "exception.hpp"
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <format>
+#include <oneapi/tbb/global_control.h>
+#include <oneapi/tbb/task_scheduler_observer.h>
+#include <optional>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+#include <thread>
+
+namespace glos {
+
+// placement of render, update and worker threads on cpus and number of
+// workers used by parallel passes
+// * cpu sets are configured as lists of cpus and ranges e.g. "0-3,8"
+// * workers are the threads of the parallel algorithms (tbb) and the threads
+//   of the update jobs
+// * threads with an empty cpu set run on the cpus the process was started
+//   with even though they are created by the pinned render thread
+class topology final {
+    // pins tbb worker threads when they join the default arena
+    class worker_observer final : public tbb::task_scheduler_observer {
+        cpu_set_t const& cpus_;
+
+      public:
+        explicit worker_observer(cpu_set_t const& cpus) : cpus_{cpus} {}
+
+        auto on_scheduler_entry(bool const is_worker) -> void override {
+            if (is_worker) {
+                // note: cpus are validated at 'init'
+                pthread_setaffinity_np(pthread_self(), sizeof(cpus_), &cpus_);
+            }
+        }
+    };
+
+    cpu_set_t original_cpus_{}; // of the process before any thread is pinned
+    cpu_set_t render_cpus_{};
+    cpu_set_t update_cpus_{};
+    cpu_set_t workers_cpus_{};
+    uint32_t workers_count_ = 0;
+    std::optional<tbb::global_control> workers_control_{};
+    std::optional<worker_observer> workers_observer_{};
+
+  public:
+    // note: called from render thread
+    auto init() -> void {
+        if (sched_getaffinity(0, sizeof(original_cpus_), &original_cpus_)) {
+            throw exception{std::format("topology: {}", strerror(errno))};
+        }
+        render_cpus_ = parse_cpus(render_thread_cpus);
+        update_cpus_ = parse_cpus(update_thread_cpus);
+        workers_cpus_ = parse_cpus(workers_cpus);
+
+        workers_count_ = workers_count ? workers_count
+                                       : std::thread::hardware_concurrency();
+        if (workers_count) {
+            workers_control_.emplace(
+                tbb::global_control::max_allowed_parallelism, workers_count);
+        }
+        // note: tbb workers are created by the render thread thus they are
+        //       pinned also when only the render thread is
+        if (CPU_COUNT(&workers_cpus_) || CPU_COUNT(&render_cpus_)) {
+            workers_observer_.emplace(cpus_or_original(workers_cpus_));
+            workers_observer_->observe(true);
+        }
+
+        pin(render_cpus_);
+    }
+
+    auto free() -> void {
+        if (workers_observer_) {
+            workers_observer_->observe(false);
+            workers_observer_.reset();
+        }
+        workers_control_.reset();
+    }
+
+    // note: called from update thread when started
+    auto pin_update_thread() const -> void { pin(update_cpus_); }
+
+    // note: called from threads of update jobs when started
+    auto pin_worker_thread() const -> void { pin(workers_cpus_); }
+
+    auto print(FILE* f) const -> void {
+        if (threaded_grid) {
+            fprintf(f, "threaded grid on %u cores\n",
+                    std::thread::hardware_concurrency());
+        }
+        fprintf(f, "  workers: %u  spin: %u us  cpus: %s\n", workers_count_,
+                workers_spin_us, cpus_to_string(workers_cpus_).c_str());
+        fprintf(f, "  render thread cpus: %s\n",
+                cpus_to_string(render_cpus_).c_str());
+        fprintf(f, "  update thread cpus: %s\n\n",
+                cpus_to_string(update_cpus_).c_str());
+    }
+
+  private:
+    // @return 'cpus' or the cpus of the process at 'init' if empty
+    auto cpus_or_original(cpu_set_t const& cpus) const -> cpu_set_t const& {
+        return CPU_COUNT(&cpus) ? cpus : original_cpus_;
+    }
+
+    // pins calling thread to 'cpus' or to the cpus of the process at 'init' if
+    // empty
+    // note: threads inherit the affinity of the creating thread thus an empty
+    //       set restores the original instead of keeping the inherited
+    auto pin(cpu_set_t const& cpus) const -> void {
+        cpu_set_t const& set = cpus_or_original(cpus);
+        int const err =
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err) {
+            throw exception{std::format("topology: cannot pin thread: {}",
+                                        strerror(err))};
+        }
+    }
+
+    // @return set of cpus in 'list' e.g. "0-3,8" or empty set if 'list' is
+    //         empty
+    static auto parse_cpus(char const* list) -> cpu_set_t {
+        cpu_set_t allowed{};
+        if (sched_getaffinity(0, sizeof(allowed), &allowed)) {
+            throw exception{std::format("topology: {}", strerror(errno))};
+        }
+
+        cpu_set_t cpus{};
+        CPU_ZERO(&cpus);
+        char const* p = list;
+        while (*p) {
+            uint32_t first = 0;
+            uint32_t last = 0;
+            if (!parse_uint(p, first)) {
+                throw exception{
+                    std::format("topology: invalid cpu list '{}'", list)};
+            }
+            last = first;
+            if (*p == '-') {
+                ++p;
+                if (!parse_uint(p, last) || last < first) {
+                    throw exception{
+                        std::format("topology: invalid cpu list '{}'", list)};
+                }
+            }
+            for (uint32_t cpu = first; cpu <= last; ++cpu) {
+                if (cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed)) {
+                    throw exception{std::format(
+                        "topology: cpu {} in '{}' is not available", cpu,
+                        list)};
+                }
+                CPU_SET(cpu, &cpus);
+            }
+            if (*p == ',') {
+                ++p;
+            } else if (*p) {
+                throw exception{
+                    std::format("topology: invalid cpu list '{}'", list)};
+            }
+        }
+        return cpus;
+    }
+
+    // @return false if 'p' does not point to a number
+    static auto parse_uint(char const*& p, uint32_t& value) -> bool {
+        if (*p < '0' || *p > '9') {
+            return false;
+        }
+        value = 0;
+        while (*p >= '0' && *p <= '9') {
+            value = value * 10 + uint32_t(*p - '0');
+            ++p;
+        }
+        return true;
+    }
+
+    // @return 'cpus' as a list of cpus and ranges or "any" if empty
+    static auto cpus_to_string(cpu_set_t const& cpus) -> std::string {
+        std::string str{};
+        for (uint32_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (!CPU_ISSET(cpu, &cpus)) {
+                continue;
+            }
+            uint32_t last = cpu;
+            while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &cpus)) {
+                ++last;
+            }
+            if (!str.empty()) {
+                str += ',';
+            }
+            str += last == cpu ? std::format("{}", cpu)
+                               : std::format("{}-{}", cpu, last);
+            cpu = last;
+        }
+        return str.empty() ? "any" : str;
+    }
+} static topology{};
+
+} // namespace glos